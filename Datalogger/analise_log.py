@@ -9,6 +9,7 @@ from datetime import datetime
 from scipy.interpolate import interp1d
 from scipy.signal import find_peaks, savgol_filter
 import warnings
+from converter_log import converter_pasta
 
 # =================================================================
 # PAINEL DE CONTROLE - CONFIGURAÇÕES VALIDADAS POR VOCÊ
@@ -86,6 +87,7 @@ def gerar_mapa_master(df_mov, top_laps):
     return [{'id': i+1, 'dist_ref': np.mean([c['dist'] for c in g]), 'lat': np.mean([c['lat'] for c in g]), 'lon': np.mean([c['lon'] for c in g])} for i, g in enumerate(curvas_finais)]
 
 def processar_sessao():
+    converter_pasta()  # Logs binários (.kbl) do cartão viram data_*.csv
     arquivos_data = glob.glob("data_*.csv")
     for f_data in arquivos_data:
         sessao_id = f_data.replace("data_", "").replace(".csv", "")
@@ -105,7 +107,9 @@ def processar_sessao():
                 mask = df_mov['Lap'] == v
                 df_mov.loc[mask, 'Dist'] = calcular_distancia_metros(df_mov[mask])
 
-            top_laps_sorted = df_laps.sort_values('Time_sec')
+            # Voltas cronometradas por posição estimada (sem GNSS na linha) ficam fora do ranking
+            df_rank = df_laps[df_laps['Estimated'] == 0] if 'Estimated' in df_laps.columns else df_laps
+            top_laps_sorted = df_rank.sort_values('Time_sec')
             top_3_nums = top_laps_sorted['Lap'].head(3).tolist()
             mapa_fixo = gerar_mapa_master(df_mov, top_3_nums)
             
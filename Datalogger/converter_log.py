@@ -0,0 +1,201 @@
+import glob
+import os
+import struct
+import sys
+import zlib
+from datetime import datetime, timedelta
+
+# =================================================================
+# CONVERSOR DO LOG BINÁRIO (data_*.kbl) PARA O CSV CLÁSSICO
+# Colunas: Timestamp_ms,Date,Time,Mode,Lap,Speed,Lat,Lon
+# =================================================================
+
+MAGIC = b"KBLG"
+MAGIC_IDX = b"KBLI"
+MAGIC_BLOCO = 0xB10C
+FLAG_BLOCOS = 0x01
+TIPOS = {1: "B", 2: "H", 3: "I", 4: "b", 5: "h", 6: "i"}
+CSV_HEADER = "Timestamp_ms,Date,Time,Mode,Lap,Speed,Lat,Lon\n"
+
+
+def ler_cabecalho(dados):
+    if len(dados) < 32 or dados[:4] != MAGIC:
+        raise ValueError("não é um log KartBox")
+    versao, tam_cab, tam_reg, n_canais, flags = struct.unpack_from("<HHHBB", dados, 4)
+    sessao = struct.unpack_from("<H", dados, 12)[0]
+    ano, mes, dia, hora, minuto, seg = struct.unpack_from("<6B", dados, 14)
+    t0_ms, confirmado = struct.unpack_from("<II", dados, 20)
+
+    canais = {}
+    for i in range(n_canais):
+        c = 32 + i * 32
+        nome = dados[c:c + 16].split(b"\0")[0].decode()
+        unidade = dados[c + 16:c + 24].split(b"\0")[0].decode()
+        tipo, offset, shift, bits, expo = struct.unpack_from("<BBBBb", dados, c + 24)
+        canais[nome] = (TIPOS[tipo], offset, shift, bits, expo, unidade)
+
+    inicio = None
+    if mes:
+        inicio = datetime(2000 + ano, mes, dia, hora, minuto, seg)
+    return {"versao": versao, "tam_cab": tam_cab, "tam_reg": tam_reg, "flags": flags, "sessao": sessao,
+            "inicio": inicio, "t0_ms": t0_ms, "confirmado": confirmado, "canais": canais}
+
+
+def canal_bruto(reg, canal):
+    fmt, offset, shift, bits, _, _ = canal
+    v = struct.unpack_from("<" + fmt, reg, offset)[0]
+    if bits:
+        v = (v >> shift) & ((1 << bits) - 1)
+    return v
+
+
+def larguras_campos(cab):
+    """Campos do codec de blocos: cada offset distinto dos canais (bitfields dividem o byte)."""
+    larguras, prox = [], 0
+    for fmt, offset, *_ in sorted(cab["canais"].values(), key=lambda c: c[1]):
+        if offset < prox:
+            continue
+        larguras.append(struct.calcsize("<" + fmt))
+        prox = offset + larguras[-1]
+    return larguras
+
+
+def ler_blocos(dados, pos, fim, larguras):
+    """Gera (offset do bloco, [registros em bytes]) enquanto os blocos forem íntegros (CRC)."""
+    while pos + 12 <= fim:
+        magic, n, carga, _, crc = struct.unpack_from("<HHHHI", dados, pos)
+        ini = pos + 12
+        if magic != MAGIC_BLOCO or ini + carga > fim or zlib.crc32(dados[ini:ini + carga]) != crc:
+            return
+        anterior = [0] * len(larguras)
+        regs, p = [], ini
+        for _ in range(n):
+            reg = b""
+            for i, w in enumerate(larguras):
+                z, s = 0, 0
+                while True:
+                    b = dados[p]
+                    p += 1
+                    z |= (b & 0x7F) << s
+                    s += 7
+                    if not b & 0x80:
+                        break
+                d = (z >> 1) ^ -(z & 1)
+                anterior[i] = (anterior[i] + d) & ((1 << (8 * w)) - 1)
+                reg += anterior[i].to_bytes(w, "little")
+            regs.append(reg)
+        yield pos, regs
+        pos = ini + carga
+
+
+def ler_registros(caminho):
+    """Gera (cabeçalho, dict canal -> valor bruto) para cada registro completo."""
+    with open(caminho, "rb") as f:
+        dados = f.read()
+    cab = ler_cabecalho(dados)
+    tam = cab["tam_reg"]
+    if cab["flags"] & FLAG_BLOCOS:
+        # Comprimido: vale todo bloco com CRC certo, até o primeiro que falhar
+        regs = [{nome: canal_bruto(reg, c) for nome, c in cab["canais"].items()}
+                for _, bloco in ler_blocos(dados, cab["tam_cab"], len(dados), larguras_campos(cab))
+                for reg in bloco]
+        return cab, regs
+    # Registro incompleto no fim (desligamento no meio da gravação) é ignorado
+    fim = cab["tam_cab"] + (len(dados) - cab["tam_cab"]) // tam * tam
+    # Sessão não fechada (cartão tirado antes do KartBox religar e recuperar):
+    # depois do último checkpoint só vale o que continua a sequência
+    confirmado = cab["confirmado"] if cab["tam_cab"] <= cab["confirmado"] <= fim else cab["tam_cab"]
+    regs = []
+    anterior = None
+    for pos in range(cab["tam_cab"], fim, tam):
+        reg = dados[pos:pos + tam]
+        r = {nome: canal_bruto(reg, c) for nome, c in cab["canais"].items()}
+        if pos >= confirmado and "seq" in r:
+            if anterior is None:
+                anterior = {"seq": 15, "t_ms": cab["t0_ms"]}
+            if r["seq"] != (anterior["seq"] + 1) & 0xF or not 0 <= (r["t_ms"] - anterior["t_ms"]) & 0xFFFFFFFF <= 10000:
+                break
+        regs.append(r)
+        anterior = r
+    return cab, regs
+
+
+def ler_indice(caminho):
+    """Índice de voltas (idx_*.kbi) do log: {volta: (offset, nº de registros)}."""
+    pasta, nome = os.path.split(caminho)
+    idx = os.path.join(pasta, "idx_" + nome[len("data_"):-4] + ".kbi")
+    if not os.path.exists(idx):
+        return None
+    with open(idx, "rb") as f:
+        dados = f.read()
+    if dados[:4] != MAGIC_IDX:
+        return None
+    tam, n = struct.unpack_from("<HI", dados, 6)
+    voltas = {}
+    for i in range(n):
+        volta, _, offset, qtd = struct.unpack_from("<HHII", dados, 16 + i * tam)
+        voltas[volta] = (offset, qtd)
+    return voltas
+
+
+def ler_volta(caminho, volta):
+    """Registros de uma volta só: um seek pelo índice, sem varrer o log."""
+    indice = ler_indice(caminho)
+    if indice is None:  # Log sem índice: varre e filtra
+        cab, regs = ler_registros(caminho)
+        return cab, [r for r in regs if r["lap"] == volta & 0xFF]
+    offset, qtd = indice.get(volta, (0, 0))
+    with open(caminho, "rb") as f:
+        cab = ler_cabecalho(f.read(512))
+        f.seek(offset)
+        if cab["flags"] & FLAG_BLOCOS:
+            # A volta começa num bloco; lê até o início da volta seguinte
+            seguintes = [o for o, _ in indice.values() if o > offset]
+            dados = f.read(min(seguintes) - offset) if seguintes else f.read()
+            brutos = [r for _, b in ler_blocos(dados, 0, len(dados), larguras_campos(cab)) for r in b][:qtd]
+        else:
+            dados = f.read(qtd * cab["tam_reg"])
+            tam = cab["tam_reg"]
+            brutos = [dados[p:p + tam] for p in range(0, len(dados) - tam + 1, tam)]
+    regs = [{nome: canal_bruto(r, c) for nome, c in cab["canais"].items()} for r in brutos]
+    return cab, regs
+
+
+def converter_arquivo(caminho, destino=None):
+    cab, regs = ler_registros(caminho)
+    destino = destino or caminho[:-4] + ".csv"
+    inicio, t0 = cab["inicio"], cab["t0_ms"]
+    with open(destino, "w", newline="") as out:
+        out.write(CSV_HEADER)
+        for r in regs:
+            if inicio:
+                t = inicio + timedelta(milliseconds=(r["t_ms"] - t0) & 0xFFFFFFFF)
+                data, hora = t.strftime("%d/%m/%y"), t.strftime("%H:%M:%S")
+            else:
+                data, hora = "00/00/00", "00:00:00"
+            modo = "RACE" if r["mode"] else "QUALY"
+            kmh = r["speed"] * 0.036  # cm/s -> km/h
+            out.write(f"{r['t_ms']},{data},{hora},{modo},{r['lap']},{kmh:.1f},"
+                      f"{r['lat'] * 1e-7:.7f},{r['lon'] * 1e-7:.7f}\n")
+    return destino, len(regs)
+
+
+def converter_pasta(pasta="."):
+    """Converte todo data_*.kbl que ainda não tenha o CSV correspondente."""
+    for kbl in glob.glob(os.path.join(pasta, "data_*.kbl")):
+        csv = kbl[:-4] + ".csv"
+        if os.path.exists(csv) and os.path.getmtime(csv) >= os.path.getmtime(kbl):
+            continue
+        try:
+            destino, n = converter_arquivo(kbl, csv)
+            print(f">>> {os.path.basename(kbl)} -> {os.path.basename(destino)} ({n} amostras)")
+        except Exception as e:
+            print(f"Erro ao converter {kbl}: {e}")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        for arq in sys.argv[1:]:
+            print(converter_arquivo(arq))
+    else:
+        converter_pasta()
@@ -21,17 +21,64 @@
 #define GPS_TX_PIN          52
 #define GPS_RX_PIN          51
 #define GPS_BAUD_RATE       115200 
+#define GPS_PROTOCOL        GPS_PROTO_NMEA // GPS_PROTO_NMEA (GGA+RMC) ou GPS_PROTO_UBX (NAV-PVT, só u-blox: a porta vira só UBX)
+#define GPS_RATE_HZ         10     // 25 Hz exige módulo u-blox M9/M10
+#define GPS_RING_SIZE       32     // Fixes no anel (potência de 2)
+#define GPS_TASK_PRIO       6
 
 // MPU-6050 (I2C0)
 #define MPU_I2C_NUM         I2C_NUM_0
 #define MPU_SDA_PIN         7   
 #define MPU_SCL_PIN         8   
 #define MPU_I2C_FREQ        400000 // Frequência do barramento I2C
+#define MPU_INT_PIN         -1     // GPIO do data-ready do MPU (ex.: 9); -1 = sem fio, drena por tempo
+#define MPU_SAMPLE_HZ       1000   // Taxa de saída (DLPF ligado: giro interno a 1 kHz)
+#define MPU_DLPF_CFG        2      // DLPF 94/98 Hz (acel/giro): abaixo de Nyquist a 1 kHz
+#define MPU_ACCEL_FS        2      // 0..3 = ±2/4/8/16 g
+#define MPU_GYRO_FS         1      // 0..3 = ±250/500/1000/2000 °/s
+#define MPU_DRAIN_SAMPLES   10     // Interrupções por leitura do FIFO (100 Hz a 1 kHz)
+#define MPU_FIFO_BURST      480    // Bytes por transação I2C (40 amostras)
+#define MPU_RING_SIZE       2048   // Amostras no anel (potência de 2, ~2 s a 1 kHz)
+#define MPU_TASK_PRIO       5
+#define IMU_LPF_HZ          25     // Anti-alias antes da decimação (Butterworth)
+#define IMU_LPF_ORDER       4
+#define IMU_DECIM           10     // 1 kHz -> 100 Hz para a tela, o log e a fusão
+#define IMU_OUT_RING_SIZE   256    // Amostras filtradas no anel (potência de 2)
+#define IMU_CAL_STILL_MMS   300    // Abaixo disso (GPS) o kart conta como parado
+#define IMU_CAL_STILL_FIXES 30     // Fixes paradas para gravidade e bias do giro (3 s a 10 Hz)
+#define IMU_CAL_MIN_ACCEL_G 0.10f  // Aceleração/frenagem mínima para achar a frente
+#define IMU_CAL_MAX_YAW_DPS 8.0f   // Só trechos retos (curva mistura lateral na frente)
+#define IMU_CAL_ENERGY_G2   2.0f   // Σ a² (g²) exigido antes de fechar a calibração
+#define IMU_CAL_MAX_TILT_DEG 10.0f // Parado e fora disso: sensor mexeu, recalibra
+
+// Fusão GPS + IMU (cronômetro e painel a 100 Hz)
+#define GPS_FUSION          1
+#define GPS_FUSION_LATENCY_MS 50   // Medida -> chegada da fix (NAV-PVT a 10 Hz)
+#define GPS_DR_MAX_MS       3000   // Dead reckoning: quanto tempo sem fix ainda dá posição
+#define GPS_DR_EST_MS       300    // Sem fix há mais que isso, o ponto conta como estimado
 
 // ========== CONSTANTES DE TELEMETRIA ==========
 #define MAX_LAPS            100    // Limite de voltas na memória
 #define UI_UPDATE_MS        100 
-#define GATE_RADIUS_M       12.0   // Raio do portão virtual (metros)
+#define GATE_RADIUS_M       12.0   // Meia largura da linha de chegada (metros)
 #define MIN_LAP_TIME_MS     20000  // Tempo mínimo de volta (evita triggers falsos)
+#define SPLIT_HOLD_MS       1000   // Segurar o botão LINHA: parcial manual no ponto atual
+#define LAP_TRACE_MAX_PTS   16384  // Pontos por volta (PSRAM; com a fusão a 100 Hz, 160 s)
+#define LAP_REF_MAX_M       8000   // Comprimento máximo da referência (1 ponto/m)
+#define SECTOR_AUTO_COUNT   3      // Setores automáticos se a pista não tiver parciais (0 = desliga)
+#define SD_LOG_BUF_SIZE     (64 * 1024) // Buffer do log na PSRAM (múltiplo do setor)
+#define SD_LOG_BUF_COUNT    2      // Buffers em rodízio (ping-pong)
+#define SD_WRITER_PRIO      3      // Abaixo da gps_task: gravação nunca atrasa fix
+#define SD_SESSION_PREALLOC (8 * 1024 * 1024) // Reserva contígua por sessão (~14 h a 10 Hz)
+#define SD_SYNC_INTERVAL_MS 2000   // Perda máxima num corte de energia (tempo)...
+#define SD_SYNC_BYTES       (16 * 1024) // ...ou volume, o que vier primeiro
+#define SD_LOG_COMPRESS     1      // Corpo do .kbl em blocos delta + varint (log_codec)
+#define SD_LOG_BLOCK_RECS   64     // Registros por bloco (o bloco também fecha na troca de volta)
+#define SD_MANIFEST_PATH    "/sdcard/sessions.idx"
+#define SD_CONSIST_PCT      107    // Voltas acima disso (% da melhor) não contam na consistência
+#define TRACK_DB_PATH       "/sdcard/tracks.db"
+#define TRACK_MATCH_M       1500.0f // Distância máxima até a linha para reconhecer a pista
+#define TRACK_LOOKUP_MS     1000   // Intervalo entre buscas no banco enquanto não armado
+#define TRACK_ARM_KMH       10     // Após encerrar a sessão, só rearma acima desta velocidade
 
 #endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "gps_fusion.h"
+#include <math.h>
+#include <string.h>
+
+// Ruídos do modelo (desvio padrão). A aceleração inclui vibração e a
+// inclinação da pista que o filtro da IMU não tira; o termo de posição
+// cobre o escorregamento (rumo do chassi != rumo da trajetória).
+#define SIG_ACC     0.5f        // m/s²
+#define SIG_GYRO    0.02f       // rad/s
+#define SIG_BA      0.05f       // m/s² por √s
+#define SIG_BG      0.002f      // rad/s por √s
+#define SIG_POS     0.05f       // m por √s
+// Ruídos da fix
+#define SIG_FIX_POS 0.8f        // m
+#define SIG_FIX_V   0.15f       // m/s
+#define SIG_FIX_CRS 0.3f        // m/s de erro lateral: rumo vale σ/v rad
+#define MIN_CRS_V   3.0f        // Abaixo disso o rumo do GNSS é ruído
+#define GATE_CHI2   25.0f       // Inovação acima de 5σ é fix ruim
+#define MAX_REJECTS 5           // Depois disso o filtro é que está errado: reinicia
+#define MAX_STEP_US 100000      // Buraco maior na IMU não é integrado
+#define MAX_TURN    1.5f        // rad/s: acima disso a taxa de curva das fixes é ruído
+
+enum { X, Y, V, CRS, BA, BG };
+
+static float wrap_pi(float a) {
+    while (a > (float)M_PI) a -= 2.0f * (float)M_PI;
+    while (a < -(float)M_PI) a += 2.0f * (float)M_PI;
+    return a;
+}
+
+// Um passo do modelo. Com 'P', também propaga a covariância (P = F P Fᵀ + Q)
+static void predict(float *s, float P[FUSION_N][FUSION_N], float a, float w, float dt) {
+    float sn = sinf(s[CRS]), cs = cosf(s[CRS]), v = s[V];
+    s[X] += v * sn * dt;
+    s[Y] += v * cs * dt;
+    s[V] += (a - s[BA]) * dt;
+    if (s[V] < 0) s[V] = 0;             // Kart não anda de ré
+    s[CRS] = wrap_pi(s[CRS] + (w - s[BG]) * dt);
+    if (!P) return;
+
+    float F[FUSION_N][FUSION_N] = {{0}};
+    for (int i = 0; i < FUSION_N; i++) F[i][i] = 1.0f;
+    F[X][V] = sn * dt;  F[X][CRS] = v * cs * dt;
+    F[Y][V] = cs * dt;  F[Y][CRS] = -v * sn * dt;
+    F[V][BA] = -dt;
+    F[CRS][BG] = -dt;
+
+    float FP[FUSION_N][FUSION_N];
+    for (int i = 0; i < FUSION_N; i++)
+        for (int j = 0; j < FUSION_N; j++) {
+            float acc = 0;
+            for (int k = 0; k < FUSION_N; k++) acc += F[i][k] * P[k][j];
+            FP[i][j] = acc;
+        }
+    for (int i = 0; i < FUSION_N; i++)
+        for (int j = i; j < FUSION_N; j++) {
+            float acc = 0;
+            for (int k = 0; k < FUSION_N; k++) acc += FP[i][k] * F[j][k];
+            P[i][j] = P[j][i] = acc;
+        }
+    P[X][X] += SIG_POS * SIG_POS * dt;
+    P[Y][Y] += SIG_POS * SIG_POS * dt;
+    P[V][V] += SIG_ACC * SIG_ACC * dt * dt;
+    P[CRS][CRS] += SIG_GYRO * SIG_GYRO * dt * dt;
+    P[BA][BA] += SIG_BA * SIG_BA * dt;
+    P[BG][BG] += SIG_BG * SIG_BG * dt;
+}
+
+static float step_dt(uint32_t from_us, uint32_t to_us) {
+    int32_t d = (int32_t)(to_us - from_us);
+    return (d <= 0 || d > MAX_STEP_US) ? 0.0f : d * 1e-6f;
+}
+
+// Medida direta do estado 'i': H é uma linha unitária, S é escalar
+static bool update(gps_fusion_t *f, int i, float z, float r) {
+    float S = f->P[i][i] + r;
+    float y = z - f->s[i];
+    if (i == CRS) y = wrap_pi(y);
+    if (y * y > GATE_CHI2 * S) return false;
+    float K[FUSION_N], row[FUSION_N];
+    for (int j = 0; j < FUSION_N; j++) { K[j] = f->P[j][i] / S; row[j] = f->P[i][j]; }
+    for (int j = 0; j < FUSION_N; j++) {
+        f->s[j] += K[j] * y;
+        for (int k = 0; k < FUSION_N; k++) f->P[j][k] -= K[j] * row[k];
+    }
+    f->s[CRS] = wrap_pi(f->s[CRS]);
+    if (f->s[V] < 0) f->s[V] = 0;
+    return true;
+}
+
+void gps_fusion_reset(gps_fusion_t *f) { memset(f, 0, sizeof(*f)); }
+
+static void core_step(gps_fusion_t *f, const fusion_input_t *in) {
+    predict(f->s, f->P, in->a, in->w, step_dt(f->core_t_us, in->t_us));
+    f->core_t_us = in->t_us;
+}
+
+void gps_fusion_imu(gps_fusion_t *f, uint32_t t_us, float a_long_g, float yaw_dps) {
+    if (!f->ready) return;
+    // Sem fix por muito tempo: o core anda junto e a covariância cresce
+    if (f->h_head - f->h_core == FUSION_HIST) core_step(f, &f->hist[f->h_core++ % FUSION_HIST]);
+    // Guinada + (esquerda) diminui o rumo (horário)
+    fusion_input_t in = { t_us, a_long_g * 9.80665f, -yaw_dps * (float)M_PI / 180.0f };
+    f->hist[f->h_head++ % FUSION_HIST] = in;
+    predict(f->head.s, NULL, in.a, in.w, step_dt(f->head.t_us, t_us));
+    f->head.t_us = t_us;
+}
+
+static void init_from_fix(gps_fusion_t *f, const gps_data_t *fix, uint32_t t_meas_us) {
+    geo_proj_init(&f->proj, fix->lat_e7, fix->lon_e7);
+    memset(f->s, 0, sizeof(f->s));
+    memset(f->P, 0, sizeof(f->P));
+    f->s[V] = fix->speed_mms * 1e-3f;
+    f->s[CRS] = wrap_pi(fix->course_cd * (float)M_PI / 18000.0f);
+    f->P[X][X] = f->P[Y][Y] = SIG_FIX_POS * SIG_FIX_POS;
+    f->P[V][V] = SIG_FIX_V * SIG_FIX_V;
+    f->P[CRS][CRS] = f->s[V] > MIN_CRS_V ? 0.05f : (float)(M_PI * M_PI);
+    f->P[BA][BA] = 0.5f * 0.5f;
+    f->P[BG][BG] = 0.05f * 0.05f;
+    f->core_t_us = t_meas_us;
+    f->h_core = f->h_head;
+    f->rejects = 0;
+    f->ready = true;
+}
+
+void gps_fusion_fix(gps_fusion_t *f, const gps_data_t *fix, uint32_t t_meas_us) {
+    if (!fix->valid) return;
+    if (!f->ready || f->rejects >= MAX_REJECTS) {
+        init_from_fix(f, fix, t_meas_us);
+    } else {
+        // Core até o instante da medida; o que vem depois fica para a head
+        while (f->h_core != f->h_head && (int32_t)(f->hist[f->h_core % FUSION_HIST].t_us - t_meas_us) <= 0)
+            core_step(f, &f->hist[f->h_core++ % FUSION_HIST]);
+
+        geo_point_t p = geo_project(&f->proj, fix->lat_e7, fix->lon_e7);
+        float v = fix->speed_mms * 1e-3f;
+        bool ok = update(f, X, p.x, SIG_FIX_POS * SIG_FIX_POS);
+        ok = update(f, Y, p.y, SIG_FIX_POS * SIG_FIX_POS) && ok;
+        ok = update(f, V, v, SIG_FIX_V * SIG_FIX_V) && ok;
+        if (v > MIN_CRS_V) {
+            float sc = SIG_FIX_CRS / v;
+            update(f, CRS, fix->course_cd * (float)M_PI / 18000.0f, sc * sc);
+        }
+        f->rejects = ok ? 0 : f->rejects + 1;
+    }
+
+    // Head refeita: core corrigido + entradas depois da medida
+    memcpy(f->head.s, f->s, sizeof(f->s));
+    f->head.t_us = f->core_t_us;
+    for (uint32_t i = f->h_core; i != f->h_head; i++) {
+        const fusion_input_t *in = &f->hist[i % FUSION_HIST];
+        predict(f->head.s, NULL, in->a, in->w, step_dt(f->head.t_us, in->t_us));
+        f->head.t_us = in->t_us;
+    }
+    f->last_fix = *fix;
+    f->last_fix_us = t_meas_us;
+    f->last_meas_ms = fix->timestamp_ms - ((uint32_t)(fix->timestamp_ms * 1000u) - t_meas_us) / 1000u;
+}
+
+bool gps_fusion_output(const gps_fusion_t *f, gps_data_t *out) {
+    if (!f->ready) return false;
+    *out = f->last_fix;
+    geo_unproject(&f->proj, (geo_point_t){ f->head.s[X], f->head.s[Y] }, &out->lat_e7, &out->lon_e7);
+    out->speed_mms = (int32_t)lroundf(f->head.s[V] * 1000.0f);
+    float deg = f->head.s[CRS] * 180.0f / (float)M_PI;
+    if (deg < 0) deg += 360.0f;
+    out->course_cd = (uint16_t)((uint32_t)lroundf(deg * 100.0f) % 36000u);
+    int32_t dt_ms = (int32_t)(f->head.t_us - f->last_fix_us) / 1000;
+    out->timestamp_ms = f->last_meas_ms + (uint32_t)dt_ms;
+    out->gnss_ms = (uint32_t)(((int64_t)f->last_fix.gnss_ms + dt_ms + GNSS_DAY_MS) % GNSS_DAY_MS);
+    return true;
+}
+
+void gps_dr_ctrv(const gps_data_t *a, const gps_data_t *b, uint32_t dt_ms, gps_data_t *out) {
+    float v = b->speed_mms * 1e-3f;
+    float th0 = b->course_cd * (float)M_PI / 18000.0f;
+    float w = 0;
+    int32_t dt_ab = (int32_t)(b->timestamp_ms - a->timestamp_ms);
+    if (dt_ab > 0 && v > MIN_CRS_V && a->speed_mms * 1e-3f > MIN_CRS_V) {
+        w = wrap_pi(th0 - a->course_cd * (float)M_PI / 18000.0f) / (dt_ab * 1e-3f);
+        if (w > MAX_TURN) w = MAX_TURN;
+        if (w < -MAX_TURN) w = -MAX_TURN;
+    }
+    float t = dt_ms * 1e-3f, th = th0 + w * t;
+    geo_point_t p;
+    if (fabsf(w) < 1e-3f) {
+        p = (geo_point_t){ v * sinf(th0) * t, v * cosf(th0) * t };
+    } else {
+        p = (geo_point_t){ v / w * (cosf(th0) - cosf(th)), v / w * (sinf(th) - sinf(th0)) };
+    }
+    geo_proj_t proj;
+    geo_proj_init(&proj, b->lat_e7, b->lon_e7);
+    *out = *b;
+    geo_unproject(&proj, p, &out->lat_e7, &out->lon_e7);
+    float deg = wrap_pi(th) * 180.0f / (float)M_PI;
+    if (deg < 0) deg += 360.0f;
+    out->course_cd = (uint16_t)((uint32_t)lroundf(deg * 100.0f) % 36000u);
+    out->timestamp_ms = b->timestamp_ms + dt_ms;
+    out->gnss_ms = (b->gnss_ms + dt_ms) % GNSS_DAY_MS;
+    out->valid = true;
+    out->estimated = true;
+}
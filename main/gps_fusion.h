@@ -0,0 +1,61 @@
+#ifndef GPS_FUSION_H
+#define GPS_FUSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry_gps.h"
+#include "track_geo.h"
+
+#define FUSION_HIST 32          // Passos de IMU guardados para a fix atrasada (320 ms a 100 Hz)
+#define FUSION_N    6           // x, y, v, rumo, bias acel, bias giro
+
+// Filtro de Kalman estendido no plano local: posição (m, x = leste,
+// y = norte), velocidade (m/s), rumo (rad, 0 = norte, horário, como o
+// GNSS) e os bias da aceleração longitudinal e da guinada. A IMU
+// propaga a cada amostra; cada fix corrige com atualizações escalares
+// (cada medida é um estado, então não há inversão de matriz).
+//
+// A fix chega atrasada em relação ao instante da medida. O filtro
+// mantém dois estados: o 'core', parado no instante da última fix, e a
+// 'head', que é o core propagado com as entradas guardadas até agora. A
+// fix corrige o core no instante certo e a head é refeita a partir dele.
+typedef struct {
+    uint32_t t_us;
+    float a, w;                 // m/s², rad/s (já com o sinal do rumo)
+} fusion_input_t;
+
+typedef struct {
+    float s[FUSION_N];
+    uint32_t t_us;
+} fusion_head_t;
+
+typedef struct {
+    geo_proj_t proj;
+    bool ready;
+    float s[FUSION_N];          // Core
+    float P[FUSION_N][FUSION_N];
+    uint32_t core_t_us;
+    fusion_head_t head;
+    fusion_input_t hist[FUSION_HIST];
+    uint32_t h_head, h_core;    // Entradas [h_core, h_head) ainda não foram para o core
+    gps_data_t last_fix;        // Campos que a fusão não estima (sats, data...)
+    uint32_t last_fix_us;       // Instante local da medida (µs)
+    uint32_t last_meas_ms;      // O mesmo, no relógio do timestamp_ms
+    uint8_t rejects;            // Fixes seguidas recusadas pelo teste de inovação
+} gps_fusion_t;
+
+void gps_fusion_reset(gps_fusion_t *f);
+// Amostra da IMU nos eixos do kart: aceleração longitudinal (g) e guinada
+// (°/s, + para a esquerda), no instante local 't_us'
+void gps_fusion_imu(gps_fusion_t *f, uint32_t t_us, float a_long_g, float yaw_dps);
+// Fix medida no instante local 't_meas_us' (recebimento - latência)
+void gps_fusion_fix(gps_fusion_t *f, const gps_data_t *fix, uint32_t t_meas_us);
+// Estado atual (head) como uma fix; false = filtro ainda sem fix
+bool gps_fusion_output(const gps_fusion_t *f, gps_data_t *out);
+
+// Dead reckoning sem IMU: mantém a velocidade de 'b' e a taxa de curva
+// entre duas fixes válidas ('a' a mais antiga) e extrapola 'dt_ms' depois
+// de 'b'. A saída vem com valid e estimated ligados.
+void gps_dr_ctrv(const gps_data_t *a, const gps_data_t *b, uint32_t dt_ms, gps_data_t *out);
+
+#endif
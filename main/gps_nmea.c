@@ -0,0 +1,182 @@
+#include "gps_nmea.h"
+#include <stdint.h>
+
+typedef enum { NMEA_OTHER, NMEA_GGA, NMEA_RMC } nmea_type_t;
+typedef enum { ST_IDLE, ST_BODY, ST_CK_HI, ST_CK_LO } nmea_state_t;
+
+#define NMEA_2D(p) (((p)[0] - '0') * 10 + ((p)[1] - '0'))
+
+static int nmea_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Converte "123.456" em inteiro escalado por 10^frac (frac=3 -> 123456).
+// Casas decimais além da escala são descartadas.
+static bool nmea_fixed(const char *p, const char *end, int frac, int32_t *out) {
+    if (p == end) return false;
+    int32_t v = 0;
+    int digits = -1;
+    for (; p < end; p++) {
+        if (*p == '.') { if (digits >= 0) return false; digits = 0; continue; }
+        if (*p < '0' || *p > '9') return false;
+        if (digits >= frac) continue;
+        v = v * 10 + (*p - '0');
+        if (digits >= 0) digits++;
+    }
+    for (digits = (digits < 0) ? 0 : digits; digits < frac; digits++) v *= 10;
+    *out = v;
+    return true;
+}
+
+static bool nmea_digits(const char *p, const char *end, int n) {
+    if (end - p < n) return false;
+    for (int i = 0; i < n; i++) if (p[i] < '0' || p[i] > '9') return false;
+    return true;
+}
+
+// "hhmmss.sss" -> ms do dia
+static bool nmea_time_ms(const char *p, const char *e, uint32_t *out) {
+    int32_t v;
+    if (!nmea_digits(p, e, 6) || !nmea_fixed(p, e, 3, &v)) return false;
+    *out = (uint32_t)(v / 10000000) * 3600000u + (uint32_t)(v / 100000 % 100) * 60000u + (uint32_t)(v % 100000);
+    return true;
+}
+
+// ddmm.mmmmm (x1e5) -> graus x1e7: minutos x1e5 * 100 / 60
+static int32_t nmea_degrees_e7(int32_t raw) {
+    int32_t deg = raw / 10000000;
+    return deg * 10000000 + ((raw - deg * 10000000) * 5 + 1) / 3;
+}
+
+static void nmea_field(nmea_parser_t *c, const char *p, const char *e) {
+    int32_t v;
+    size_t n = (size_t)(e - p);
+
+    if (c->field == 0) {
+        // Ignora o talker (GP, GN, GL...), só interessa o tipo
+        c->type = NMEA_OTHER;
+        if (n == 5 && p[2] == 'G' && p[3] == 'G' && p[4] == 'A') c->type = NMEA_GGA;
+        else if (n == 5 && p[2] == 'R' && p[3] == 'M' && p[4] == 'C') c->type = NMEA_RMC;
+        return;
+    }
+
+    if (c->type == NMEA_GGA) {
+        switch (c->field) {
+            case 1: nmea_time_ms(p, e, &c->stage.gnss_ms); break;
+            case 2: c->has_lat = nmea_fixed(p, e, 5, &c->lat_raw); break;
+            case 3: c->south = (n > 0 && p[0] == 'S'); break;
+            case 4: c->has_lon = nmea_fixed(p, e, 5, &c->lon_raw); break;
+            case 5: c->west = (n > 0 && p[0] == 'W'); break;
+            case 6: if (n > 0) c->stage.valid = (p[0] != '0'); break;
+            case 7: if (nmea_fixed(p, e, 0, &v)) c->stage.sats = v; break;
+        }
+        return;
+    }
+
+    switch (c->field) {
+        case 1:
+            if (nmea_time_ms(p, e, &c->stage.gnss_ms)) {
+                int h = NMEA_2D(p);
+                c->stage.hour = (h < 3) ? h + 21 : h - 3;
+                c->stage.minute = NMEA_2D(p + 2);
+                c->stage.second = NMEA_2D(p + 4);
+            }
+            break;
+        case 2: c->stage.valid = (n > 0 && p[0] == 'A'); break;
+        case 7: if (nmea_fixed(p, e, 3, &v)) c->stage.speed_mms = (int32_t)((int64_t)v * 1852 / 3600); break; // nós x1000 -> mm/s
+        case 8: if (nmea_fixed(p, e, 2, &v)) c->stage.course_cd = (uint16_t)(v % 36000); break;
+        case 9:
+            if (nmea_digits(p, e, 6)) {
+                c->stage.day = NMEA_2D(p);
+                c->stage.month = NMEA_2D(p + 2);
+                c->stage.year = NMEA_2D(p + 4);
+            }
+            break;
+    }
+}
+
+// Fecha o campo atual. Campos maiores que o buffer são descartados.
+static void nmea_end_field(nmea_parser_t *p) {
+    if (!p->overflow) nmea_field(p, p->fbuf, p->fbuf + p->flen);
+    p->field++;
+    p->flen = 0;
+    p->overflow = false;
+}
+
+void nmea_parser_init(nmea_parser_t *p) {
+    *p = (nmea_parser_t){ .state = ST_IDLE };
+}
+
+bool nmea_parser_feed(nmea_parser_t *p, uint8_t b, gps_data_t *gps) {
+    if (b == '$') {
+        // Início de sentença (também ressincroniza no meio de uma corrompida)
+        nmea_parser_init(p);
+        p->stage = *gps;
+        p->state = ST_BODY;
+        return false;
+    }
+
+    switch (p->state) {
+        case ST_BODY:
+            if (b == '*') { nmea_end_field(p); p->state = ST_CK_HI; break; }
+            if (b == '\r' || b == '\n') { p->state = ST_IDLE; break; }
+            p->sum ^= b;
+            if (b == ',') {
+                nmea_end_field(p);
+                if (p->type == NMEA_OTHER) p->state = ST_IDLE;
+            } else if (p->flen < NMEA_FIELD_MAX) {
+                p->fbuf[p->flen++] = (char)b;
+            } else {
+                p->overflow = true;
+            }
+            break;
+
+        case ST_CK_HI: {
+            int h = nmea_hex((char)b);
+            if (h < 0) { p->state = ST_IDLE; break; }
+            p->ck = (uint8_t)(h << 4);
+            p->state = ST_CK_LO;
+            break;
+        }
+
+        case ST_CK_LO: {
+            int l = nmea_hex((char)b);
+            p->state = ST_IDLE;
+            if (l < 0 || p->type == NMEA_OTHER || p->sum != (p->ck | l)) break;
+            // Checksum confere: publica na hora, sem esperar o '\n'
+            if (p->has_lat) p->stage.lat_e7 = p->south ? -nmea_degrees_e7(p->lat_raw) : nmea_degrees_e7(p->lat_raw);
+            if (p->has_lon) p->stage.lon_e7 = p->west ? -nmea_degrees_e7(p->lon_raw) : nmea_degrees_e7(p->lon_raw);
+            *gps = p->stage;
+            // A GGA traz a posição: é ela que fecha a época e gera uma fix
+            return p->type == NMEA_GGA;
+        }
+
+        default:
+            break;
+    }
+    return false;
+}
+
+int nmea_parser_pump(nmea_parser_t *p, const gps_byte_source_t *src, gps_data_t *gps) {
+    uint8_t buf[256];
+    int len = src->read(src->ctx, buf, sizeof(buf));
+    if (len < 0) return -1;
+    int fixes = 0;
+    for (int i = 0; i < len; i++) {
+        if (nmea_parser_feed(p, buf[i], gps)) fixes++;
+    }
+    return fixes;
+}
+
+bool nmea_parse_sentence(const char *s, size_t len, gps_data_t *gps) {
+    nmea_parser_t p;
+    nmea_parser_init(&p);
+    bool ok = false;
+    for (size_t i = 0; i < len; i++) {
+        if (nmea_parser_feed(&p, (uint8_t)s[i], gps)) ok = true;
+    }
+    return ok;
+}
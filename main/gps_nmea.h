@@ -0,0 +1,37 @@
+#ifndef GPS_NMEA_H
+#define GPS_NMEA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry_gps.h"
+
+#define NMEA_FIELD_MAX 16
+
+// Máquina de estados NMEA alimentada byte a byte (sem buffer de linha).
+// Os campos são acumulados em 'stage' e só vão para o gps_data_t
+// quando o checksum *hh da sentença confere.
+typedef struct {
+    uint8_t state, type, field, sum, ck;
+    uint8_t flen;
+    bool overflow;
+    char fbuf[NMEA_FIELD_MAX];
+    gps_data_t stage;
+    int32_t lat_raw, lon_raw; // ddmm.mmmmm x 1e5
+    bool has_lat, has_lon, south, west;
+} nmea_parser_t;
+
+void nmea_parser_init(nmea_parser_t *p);
+
+// Consome um byte. GGA e RMC válidas são aplicadas em 'gps'; retorna true
+// quando foi uma GGA, que traz a posição e fecha a época.
+bool nmea_parser_feed(nmea_parser_t *p, uint8_t b, gps_data_t *gps);
+
+// Lê o que houver na fonte e alimenta o parser. Retorna o número de
+// fixes (GGA) aplicadas, ou -1 se a fonte falhar.
+int nmea_parser_pump(nmea_parser_t *p, const gps_byte_source_t *src, gps_data_t *gps);
+
+// Interpreta uma sentença completa ($..*hh) de uma só vez.
+bool nmea_parse_sentence(const char *s, size_t len, gps_data_t *gps);
+
+#endif
@@ -0,0 +1,136 @@
+#include "gps_ubx.h"
+#include <string.h>
+
+typedef enum { ST_SYNC1, ST_SYNC2, ST_CLASS, ST_ID, ST_LEN1, ST_LEN2, ST_PAYLOAD, ST_CK_A, ST_CK_B } ubx_state_t;
+
+static uint16_t rd_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd_u32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static int32_t rd_i32(const uint8_t *p) { return (int32_t)rd_u32(p); }
+
+static void wr_u16(uint8_t *p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void wr_u32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF; }
+
+// Checksum Fletcher-8 do UBX (classe, id, tamanho e payload)
+static void ubx_ck(uint8_t *a, uint8_t *b, uint8_t v) { *a += v; *b += *a; }
+
+void ubx_parser_init(ubx_parser_t *p) {
+    p->state = ST_SYNC1;
+    p->len = p->pos = 0;
+}
+
+void ubx_decode_nav_pvt(const uint8_t *pl, gps_data_t *gps) {
+    uint8_t fix_type = pl[20];
+    bool fix_ok = (pl[21] & 0x01) != 0;
+
+    gps->gnss_ms = rd_u32(pl) % 86400000u; // iTOW reduzido a ms do dia
+    gps->valid = fix_ok && fix_type >= 2 && fix_type <= 4;
+    gps->sats = pl[23];
+    gps->lon_e7 = rd_i32(pl + 24);
+    gps->lat_e7 = rd_i32(pl + 28);
+    gps->speed_mms = rd_i32(pl + 60);                   // gSpeed já vem em mm/s
+    gps->course_cd = (uint16_t)((rd_i32(pl + 64) / 1000) % 36000); // headMot em 1e-5 graus
+
+    // Data/hora só são confiáveis com validDate/validTime
+    if (pl[11] & 0x01) {
+        gps->year = rd_u16(pl + 4) % 100;
+        gps->month = pl[6];
+        gps->day = pl[7];
+    }
+    if (pl[11] & 0x02) {
+        int h = pl[8];
+        gps->hour = (h < 3) ? h + 21 : h - 3; // Mesmo fuso do caminho NMEA
+        gps->minute = pl[9];
+        gps->second = pl[10];
+    }
+}
+
+bool ubx_parser_feed(ubx_parser_t *p, uint8_t b, gps_data_t *gps) {
+    switch (p->state) {
+        case ST_SYNC1:
+            if (b == UBX_SYNC1) p->state = ST_SYNC2;
+            break;
+        case ST_SYNC2:
+            p->state = (b == UBX_SYNC2) ? ST_CLASS : (b == UBX_SYNC1 ? ST_SYNC2 : ST_SYNC1);
+            break;
+        case ST_CLASS:
+            p->cls = b; p->ck_a = p->ck_b = 0; ubx_ck(&p->ck_a, &p->ck_b, b);
+            p->state = ST_ID;
+            break;
+        case ST_ID:
+            p->id = b; ubx_ck(&p->ck_a, &p->ck_b, b);
+            p->state = ST_LEN1;
+            break;
+        case ST_LEN1:
+            p->len = b; ubx_ck(&p->ck_a, &p->ck_b, b);
+            p->state = ST_LEN2;
+            break;
+        case ST_LEN2:
+            p->len |= (uint16_t)b << 8; ubx_ck(&p->ck_a, &p->ck_b, b);
+            p->pos = 0;
+            p->state = (p->len > 0) ? ST_PAYLOAD : ST_CK_A;
+            break;
+        case ST_PAYLOAD:
+            // Mensagens maiores que o buffer são checadas mas não guardadas
+            if (p->pos < UBX_MAX_PAYLOAD) p->payload[p->pos] = b;
+            ubx_ck(&p->ck_a, &p->ck_b, b);
+            if (++p->pos == p->len) p->state = ST_CK_A;
+            break;
+        case ST_CK_A:
+            p->state = (b == p->ck_a) ? ST_CK_B : ST_SYNC1;
+            break;
+        case ST_CK_B:
+            p->state = ST_SYNC1;
+            if (b != p->ck_b) break;
+            if (p->cls == UBX_CLASS_NAV && p->id == UBX_NAV_PVT && p->len == UBX_NAV_PVT_LEN) {
+                ubx_decode_nav_pvt(p->payload, gps);
+                return true;
+            }
+            break;
+    }
+    return false;
+}
+
+int ubx_parser_pump(ubx_parser_t *p, const gps_byte_source_t *src, gps_data_t *gps) {
+    uint8_t buf[256];
+    int len = src->read(src->ctx, buf, sizeof(buf));
+    if (len < 0) return -1;
+    int fixes = 0;
+    for (int i = 0; i < len; i++) {
+        if (ubx_parser_feed(p, buf[i], gps)) fixes++;
+    }
+    return fixes;
+}
+
+size_t ubx_build_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len, uint8_t *out) {
+    out[0] = UBX_SYNC1; out[1] = UBX_SYNC2;
+    out[2] = cls; out[3] = id;
+    wr_u16(out + 4, len);
+    if (len) memcpy(out + 6, payload, len);
+    uint8_t a = 0, b = 0;
+    for (size_t i = 2; i < 6u + len; i++) ubx_ck(&a, &b, out[i]);
+    out[6 + len] = a; out[7 + len] = b;
+    return len + UBX_FRAME_OVERHEAD;
+}
+
+size_t ubx_cfg_rate(uint16_t meas_ms, uint8_t *out) {
+    uint8_t pl[6];
+    wr_u16(pl, meas_ms);
+    wr_u16(pl + 2, 1); // navRate: uma solução por medida
+    wr_u16(pl + 4, 1); // timeRef: GPS
+    return ubx_build_frame(UBX_CLASS_CFG, UBX_CFG_RATE, pl, sizeof(pl), out);
+}
+
+size_t ubx_cfg_msg(uint8_t cls, uint8_t id, uint8_t rate, uint8_t *out) {
+    uint8_t pl[3] = { cls, id, rate }; // Taxa na porta atual
+    return ubx_build_frame(UBX_CLASS_CFG, UBX_CFG_MSG, pl, sizeof(pl), out);
+}
+
+size_t ubx_cfg_prt_uart(uint32_t baud, uint16_t in_proto, uint16_t out_proto, uint8_t *out) {
+    uint8_t pl[20] = {0};
+    pl[0] = 1;                   // portID: UART1 do módulo
+    wr_u32(pl + 4, 0x000008D0);  // 8N1
+    wr_u32(pl + 8, baud);
+    wr_u16(pl + 12, in_proto);
+    wr_u16(pl + 14, out_proto);
+    return ubx_build_frame(UBX_CLASS_CFG, UBX_CFG_PRT, pl, sizeof(pl), out);
+}
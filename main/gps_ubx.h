@@ -0,0 +1,50 @@
+#ifndef GPS_UBX_H
+#define GPS_UBX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry_gps.h"
+
+#define UBX_SYNC1           0xB5
+#define UBX_SYNC2           0x62
+#define UBX_CLASS_NAV       0x01
+#define UBX_CLASS_CFG       0x06
+#define UBX_NAV_PVT         0x07
+#define UBX_CFG_PRT         0x00
+#define UBX_CFG_MSG         0x01
+#define UBX_CFG_RATE        0x08
+#define UBX_NAV_PVT_LEN     92
+#define UBX_MAX_PAYLOAD     100  // Só guardamos o que cabe um NAV-PVT
+#define UBX_FRAME_OVERHEAD  8    // sync(2) + classe/id(2) + len(2) + ck(2)
+
+// Máscaras de protocolo do CFG-PRT
+#define UBX_PROTO_UBX       0x0001
+#define UBX_PROTO_NMEA      0x0002
+
+// Framer UBX alimentado byte a byte (mesmo modelo do nmea_parser_t).
+typedef struct {
+    uint8_t state, cls, id;
+    uint16_t len, pos;
+    uint8_t ck_a, ck_b;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+} ubx_parser_t;
+
+void ubx_parser_init(ubx_parser_t *p);
+
+// Consome um byte. Retorna true quando um NAV-PVT com checksum válido
+// acabou de ser aplicado em 'gps'.
+bool ubx_parser_feed(ubx_parser_t *p, uint8_t b, gps_data_t *gps);
+int ubx_parser_pump(ubx_parser_t *p, const gps_byte_source_t *src, gps_data_t *gps);
+
+// Decodifica o payload de um NAV-PVT (92 bytes) em 'gps'.
+void ubx_decode_nav_pvt(const uint8_t *pl, gps_data_t *gps);
+
+// Montagem de frames de configuração. 'out' precisa de len + 8 bytes.
+// Retornam o tamanho total do frame.
+size_t ubx_build_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len, uint8_t *out);
+size_t ubx_cfg_rate(uint16_t meas_ms, uint8_t *out);
+size_t ubx_cfg_msg(uint8_t cls, uint8_t id, uint8_t rate, uint8_t *out);
+size_t ubx_cfg_prt_uart(uint32_t baud, uint16_t in_proto, uint16_t out_proto, uint8_t *out);
+
+#endif
@@ -0,0 +1,96 @@
+#include "imu_filter.h"
+#include <math.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "dsps_biquad.h"
+#define biquad(in, out, n, coef, w) dsps_biquad_f32(in, out, n, coef, w)
+#else
+static void biquad(const float *in, float *out, int n, const float *coef, float *w) {
+    for (int i = 0; i < n; i++) {
+        float d0 = in[i] - coef[3] * w[0] - coef[4] * w[1];
+        out[i] = coef[0] * d0 + coef[1] * w[0] + coef[2] * w[1];
+        w[1] = w[0];
+        w[0] = d0;
+    }
+}
+#endif
+
+void imu_filter_init(imu_filter_t *f, float fs, float fc, uint8_t order, uint8_t decim) {
+    memset(f, 0, sizeof(*f));
+    uint8_t n = order / 2;
+    if (n < 1) n = 1;
+    if (n > IMU_FILTER_MAX_SECT) n = IMU_FILTER_MAX_SECT;
+    f->n_sect = n;
+    f->decim = decim ? decim : 1;
+
+    // Polos do Butterworth de ordem 2n divididos em n biquads (RBJ)
+    float w0 = 2.0f * (float)M_PI * fc / fs;
+    float c = cosf(w0), s = sinf(w0);
+    for (int k = 0; k < n; k++) {
+        float q = 1.0f / (2.0f * cosf((float)M_PI * (2 * k + 1) / (4.0f * n)));
+        float alpha = s / (2.0f * q);
+        float a0 = 1.0f + alpha;
+        float *cf = f->coef[k];
+        cf[0] = (1.0f - c) / 2.0f / a0;
+        cf[1] = (1.0f - c) / a0;
+        cf[2] = cf[0];
+        cf[3] = -2.0f * c / a0;
+        cf[4] = (1.0f - alpha) / a0;
+    }
+}
+
+float imu_filter_delay(const imu_filter_t *f) {
+    // Em DC: Σk·b_k/Σb_k - Σk·a_k/Σa_k, somado sobre as seções
+    float d = 0;
+    for (int k = 0; k < f->n_sect; k++) {
+        const float *cf = f->coef[k];
+        d += (cf[1] + 2 * cf[2]) / (cf[0] + cf[1] + cf[2]) - (cf[3] + 2 * cf[4]) / (1.0f + cf[3] + cf[4]);
+    }
+    return d;
+}
+
+// Estado de regime para a entrada 'x' constante: sem o degrau de zero até
+// 1 g que o filtro levaria centenas de amostras para assentar
+static void prime(imu_filter_t *f, const mpu_raw_t *first) {
+    for (int ch = 0; ch < IMU_FILTER_CH; ch++) {
+        float x = ch < 3 ? first->acc[ch] : first->gyro[ch - 3];
+        for (int k = 0; k < f->n_sect; k++) {
+            const float *cf = f->coef[k];
+            float d = x / (1.0f + cf[3] + cf[4]);  // Ganho 1 em DC: a saída também é 'x'
+            f->w[ch][k][0] = f->w[ch][k][1] = d;
+        }
+    }
+    f->primed = 1;
+}
+
+int imu_filter_run(imu_filter_t *f, const mpu_raw_t *in, int n, imu_filter_out_t *out) {
+    static float buf[2][IMU_FILTER_BLOCK];  // Só a mpu_task filtra
+    uint16_t pick[IMU_FILTER_BLOCK];
+    int n_out = 0;
+    if (n > 0 && !f->primed) prime(f, &in[0]);
+
+    for (int base = 0; base < n; base += IMU_FILTER_BLOCK) {
+        int m = n - base;
+        if (m > IMU_FILTER_BLOCK) m = IMU_FILTER_BLOCK;
+        int k_out = 0;
+        for (int i = 0; i < m; i++) {
+            if (++f->phase < f->decim) continue;
+            f->phase = 0;
+            pick[k_out++] = (uint16_t)i;
+        }
+        for (int ch = 0; ch < IMU_FILTER_CH; ch++) {
+            for (int i = 0; i < m; i++) buf[0][i] = ch < 3 ? in[base + i].acc[ch] : in[base + i].gyro[ch - 3];
+            int cur = 0;
+            for (int k = 0; k < f->n_sect; k++, cur ^= 1) biquad(buf[cur], buf[cur ^ 1], m, f->coef[k], f->w[ch][k]);
+            for (int j = 0; j < k_out; j++) {
+                imu_filter_out_t *o = &out[n_out + j];
+                if (ch < 3) o->acc[ch] = buf[cur][pick[j]];
+                else o->gyro[ch - 3] = buf[cur][pick[j]];
+                o->src = (uint16_t)(base + pick[j]);
+            }
+        }
+        n_out += k_out;
+    }
+    return n_out;
+}
@@ -0,0 +1,37 @@
+#ifndef IMU_FILTER_H
+#define IMU_FILTER_H
+
+#include <stdint.h>
+#include "mpu6050.h"
+
+#define IMU_FILTER_MAX_SECT 4       // Até 8a ordem
+#define IMU_FILTER_BLOCK    64      // Amostras por passada do kernel
+#define IMU_FILTER_CH       6       // acel xyz, giro xyz
+
+// Passa-baixas Butterworth (cascata de biquads, ganho 1 em DC) nos seis
+// canais, seguido de decimação. Roda em blocos por canal: no ESP o
+// kernel é o dsps_biquad_f32 do esp-dsp (versão otimizada do alvo); fora
+// dele, a mesma forma direta II em C, para testes no PC.
+typedef struct {
+    float coef[IMU_FILTER_MAX_SECT][5];     // b0 b1 b2 a1 a2 (formato do esp-dsp)
+    float w[IMU_FILTER_CH][IMU_FILTER_MAX_SECT][2];
+    uint8_t n_sect;
+    uint8_t decim;
+    uint8_t phase;
+    uint8_t primed;                 // Estado já partiu da 1a amostra
+} imu_filter_t;
+
+// Saída decimada, em LSB do sensor; 'src' é o índice da entrada que a gerou
+typedef struct {
+    float acc[3], gyro[3];
+    uint16_t src;
+} imu_filter_out_t;
+
+// fc/fs em Hz; 'order' par (2..8); decim >= 1
+void imu_filter_init(imu_filter_t *f, float fs, float fc, uint8_t order, uint8_t decim);
+// Atraso de grupo em DC, em amostras de entrada (o instante que a saída representa)
+float imu_filter_delay(const imu_filter_t *f);
+// Retorna as amostras gravadas em 'out' (no máximo n / decim + 1)
+int imu_filter_run(imu_filter_t *f, const mpu_raw_t *in, int n, imu_filter_out_t *out);
+
+#endif
@@ -0,0 +1,83 @@
+#include "imu_orient.h"
+#include <math.h>
+#include <string.h>
+
+#define Q_ONE (1 << IMU_ORIENT_Q)
+
+void imu_orient_identity(imu_orient_t *o) {
+    memset(o, 0, sizeof(*o));
+    o->magic = IMU_ORIENT_MAGIC;
+    for (int i = 0; i < 3; i++) o->rot[i][i] = Q_ONE;
+}
+
+static int16_t sat16(int32_t v) { return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v); }
+
+static void rotate(const int16_t m[3][3], const int32_t in[3], int16_t out[3]) {
+    for (int i = 0; i < 3; i++) {
+        int32_t acc = m[i][0] * in[0] + m[i][1] * in[1] + m[i][2] * in[2];
+        out[i] = sat16((acc + (1 << (IMU_ORIENT_Q - 1))) >> IMU_ORIENT_Q);
+    }
+}
+
+void imu_orient_apply(const imu_orient_t *o, mpu_raw_t *s) {
+    int32_t a[3], g[3];
+    for (int i = 0; i < 3; i++) {
+        a[i] = s->acc[i];
+        g[i] = s->gyro[i] - o->gyro_bias[i];
+    }
+    rotate(o->rot, a, s->acc);
+    rotate(o->rot, g, s->gyro);
+}
+
+void imu_calib_reset(imu_calib_t *c) { memset(c, 0, sizeof(*c)); }
+
+void imu_calib_add_still(imu_calib_t *c, const float acc[3], const float gyro[3]) {
+    for (int i = 0; i < 3; i++) {
+        c->still_acc[i] += acc[i];
+        c->still_gyro[i] += gyro[i];
+    }
+    c->n_still++;
+}
+
+void imu_calib_add_motion(imu_calib_t *c, const float acc[3], float a_long) {
+    // A gravidade entra multiplicada por Σ a_gps e some na projeção
+    // horizontal do solve: não precisa do eixo z aqui
+    for (int i = 0; i < 3; i++) c->fwd[i] += (double)a_long * acc[i];
+    c->energy += (double)a_long * a_long;
+    c->n_motion++;
+}
+
+static double norm3(const double v[3]) { return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]); }
+
+bool imu_calib_up(const imu_calib_t *c, float up[3]) {
+    double n = norm3(c->still_acc);
+    if (c->n_still == 0 || n == 0) return false;
+    for (int i = 0; i < 3; i++) up[i] = (float)(c->still_acc[i] / n);
+    return true;
+}
+
+bool imu_calib_solve(const imu_calib_t *c, double min_energy, imu_orient_t *out) {
+    double nu = norm3(c->still_acc);
+    if (c->n_still == 0 || nu == 0 || c->energy < min_energy) return false;
+    double z[3], x[3], y[3];
+    for (int i = 0; i < 3; i++) z[i] = c->still_acc[i] / nu;
+
+    double dot = c->fwd[0] * z[0] + c->fwd[1] * z[1] + c->fwd[2] * z[2];
+    for (int i = 0; i < 3; i++) x[i] = c->fwd[i] - dot * z[i];
+    double nx = norm3(x);
+    // Com o eixo certo, |Σ a·h| ≈ Σ a² (inclinação ~1 na regressão); muito
+    // abaixo disso a aceleração do GPS não explica o sensor
+    double slope = nx / c->energy;
+    if (slope < 0.5 || slope > 1.5) return false;
+    for (int i = 0; i < 3; i++) x[i] /= nx;
+    y[0] = z[1] * x[2] - z[2] * x[1];
+    y[1] = z[2] * x[0] - z[0] * x[2];
+    y[2] = z[0] * x[1] - z[1] * x[0];
+
+    const double *rows[3] = { x, y, z };
+    out->magic = IMU_ORIENT_MAGIC;
+    for (int r = 0; r < 3; r++)
+        for (int i = 0; i < 3; i++) out->rot[r][i] = (int16_t)lround(rows[r][i] * Q_ONE);
+    for (int i = 0; i < 3; i++) out->gyro_bias[i] = (int16_t)lround(c->still_gyro[i] / c->n_still);
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef IMU_ORIENT_H
+#define IMU_ORIENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mpu6050.h"
+
+#define IMU_ORIENT_MAGIC 0x4B424F31u   // "KBO1"
+#define IMU_ORIENT_Q     14             // Matriz em ponto fixo Q14
+
+// Montagem do sensor no kart: rotação sensor -> kart e bias do giro.
+// Eixos do kart: x para a frente, y para a esquerda, z para cima. Com o
+// kart parado, o acelerômetro lê +1 g em z.
+typedef struct {
+    uint32_t magic;
+    int16_t rot[3][3];          // Linhas: frente, esquerda, cima (Q14)
+    int16_t gyro_bias[3];       // LSB, nos eixos do sensor
+} imu_orient_t;
+
+void imu_orient_identity(imu_orient_t *o);
+// No lugar, em LSB: tira o bias do giro e gira acel e giro para o kart
+void imu_orient_apply(const imu_orient_t *o, mpu_raw_t *s);
+
+// Calibração: o caller entrega médias por intervalo de GPS (LSB, eixos do
+// sensor). Parado, elas dão a gravidade (eixo z) e o bias do giro. Em linha
+// reta, a correlação da parte horizontal com a aceleração longitudinal
+// medida pelo GPS aponta o eixo x.
+typedef struct {
+    double still_acc[3], still_gyro[3];
+    uint32_t n_still;
+    double fwd[3];              // Σ a_gps · acel
+    double energy;              // Σ a_gps²
+    uint32_t n_motion;
+} imu_calib_t;
+
+void imu_calib_reset(imu_calib_t *c);
+void imu_calib_add_still(imu_calib_t *c, const float acc[3], const float gyro[3]);
+void imu_calib_add_motion(imu_calib_t *c, const float acc[3], float a_long);  // a_long em LSB de acel
+bool imu_calib_up(const imu_calib_t *c, float up[3]);         // false = sem amostras paradas
+// 'min_energy' em LSB² (Σ a_gps²). false = dados insuficientes ou
+// inconsistentes (eixo frente mal definido)
+bool imu_calib_solve(const imu_calib_t *c, double min_energy, imu_orient_t *out);
+
+#endif
@@ -0,0 +1,37 @@
+#include "lap_delta.h"
+
+void lap_trace_reset(lap_trace_t *tr) { tr->n = 0; }
+
+void lap_trace_add(lap_trace_t *tr, float dist_m, uint32_t t_ms) {
+    // Volta maior que o buffer: o final fica de fora da referência
+    if (tr->n >= tr->cap) return;
+    tr->pts[tr->n++] = (lap_point_t){ dist_m, t_ms };
+}
+
+void lap_ref_build(lap_ref_t *ref, const lap_trace_t *tr) {
+    ref->n = 0;
+    if (tr->n < 2) return;
+
+    uint32_t seg = 0, m = 0;
+    for (; m < ref->cap; m++) {
+        float d = (float)m;
+        if (d > tr->pts[tr->n - 1].dist_m) break;
+        while (seg + 2 < tr->n && tr->pts[seg + 1].dist_m < d) seg++;
+
+        const lap_point_t *a = &tr->pts[seg], *b = &tr->pts[seg + 1];
+        float span = b->dist_m - a->dist_m;
+        float k = (span > 0.0f) ? (d - a->dist_m) / span : 0.0f;
+        if (k < 0.0f) k = 0.0f;
+        ref->t_ms[m] = a->t_ms + (uint32_t)(k * (float)(b->t_ms - a->t_ms) + 0.5f);
+    }
+    ref->n = m;
+}
+
+bool lap_ref_lookup(const lap_ref_t *ref, float dist_m, uint32_t *t_ms) {
+    if (dist_m < 0.0f) dist_m = 0.0f;
+    uint32_t i = (uint32_t)dist_m;
+    if (i + 1 >= ref->n) return false;
+    float k = dist_m - (float)i;
+    *t_ms = ref->t_ms[i] + (uint32_t)(k * (float)(ref->t_ms[i + 1] - ref->t_ms[i]) + 0.5f);
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef LAP_DELTA_H
+#define LAP_DELTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Ponto da volta em andamento: distância percorrida desde a linha e
+// tempo decorrido até ali.
+typedef struct { float dist_m; uint32_t t_ms; } lap_point_t;
+
+typedef struct {
+    lap_point_t *pts;
+    uint32_t n, cap;
+} lap_trace_t;
+
+// Volta de referência reamostrada numa grade fixa de distância:
+// t_ms[i] é o tempo que a referência levou para chegar a i metros.
+typedef struct {
+    uint32_t *t_ms;
+    uint32_t n, cap;
+} lap_ref_t;
+
+void lap_trace_reset(lap_trace_t *tr);
+void lap_trace_add(lap_trace_t *tr, float dist_m, uint32_t t_ms);
+
+// Reamostra a trajetória na grade de 1 m. O(pontos + metros).
+void lap_ref_build(lap_ref_t *ref, const lap_trace_t *tr);
+
+// Tempo da referência na distância 'dist_m' (interpolado). O(1).
+// Retorna false se a distância passar do fim da referência.
+bool lap_ref_lookup(const lap_ref_t *ref, float dist_m, uint32_t *t_ms);
+
+#endif
@@ -0,0 +1,107 @@
+#include "log_codec.h"
+#include <string.h>
+
+// CRC-32 IEEE (o mesmo do zlib) com tabela de 4 bits: 64 bytes de
+// constante, sem inicialização em tempo de execução
+static const uint32_t crc_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t log_crc32(const uint8_t *p, size_t n) {
+    uint32_t crc = 0xFFFFFFFFu;
+    while (n--) {
+        crc ^= *p++;
+        crc = crc_nibble[crc & 0x0F] ^ (crc >> 4);
+        crc = crc_nibble[crc & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+bool log_codec_init(log_codec_t *c, const uint8_t *widths, uint8_t n_fields) {
+    if (n_fields == 0 || n_fields > LOG_CODEC_MAX_FIELDS) return false;
+    uint8_t off = 0;
+    for (uint8_t i = 0; i < n_fields; i++) {
+        if (widths[i] != 1 && widths[i] != 2 && widths[i] != 4) return false;
+        c->off[i] = off;
+        c->width[i] = widths[i];
+        off += widths[i];
+    }
+    c->n_fields = n_fields;
+    c->rec_size = off;
+    return true;
+}
+
+static uint32_t get_field(const uint8_t *p, uint8_t w) {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < w; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static void put_field(uint8_t *p, uint8_t w, uint32_t v) {
+    for (uint8_t i = 0; i < w; i++) p[i] = v >> (8 * i);
+}
+
+// Diferença no tamanho do campo, com sinal: u16 65535 -> 0 vira +1
+static int32_t field_delta(uint32_t cur, uint32_t prev, uint8_t w) {
+    uint32_t d = cur - prev;
+    if (w == 1) return (int8_t)d;
+    if (w == 2) return (int16_t)d;
+    return (int32_t)d;
+}
+
+size_t log_block_encode(const log_codec_t *c, const uint8_t *recs, uint16_t n, uint8_t *out, size_t cap) {
+    if (cap < LOG_BLOCK_HDR_SIZE) return 0;
+    uint32_t prev[LOG_CODEC_MAX_FIELDS] = {0};
+    uint8_t *p = out + LOG_BLOCK_HDR_SIZE, *end = out + cap;
+    for (uint16_t r = 0; r < n; r++, recs += c->rec_size) {
+        for (uint8_t f = 0; f < c->n_fields; f++) {
+            uint32_t v = get_field(recs + c->off[f], c->width[f]);
+            int32_t d = field_delta(v, prev[f], c->width[f]);
+            prev[f] = v;
+            uint32_t z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+            do {
+                if (p == end) return 0;
+                *p++ = (z & 0x7F) | (z > 0x7F ? 0x80 : 0);
+                z >>= 7;
+            } while (z);
+        }
+    }
+    size_t payload = p - out - LOG_BLOCK_HDR_SIZE;
+    if (payload > 0xFFFF) return 0;
+    put_field(out, 2, LOG_BLOCK_MAGIC);
+    put_field(out + 2, 2, n);
+    put_field(out + 4, 2, payload);
+    put_field(out + 6, 2, 0);
+    put_field(out + 8, 4, log_crc32(out + LOG_BLOCK_HDR_SIZE, payload));
+    return LOG_BLOCK_HDR_SIZE + payload;
+}
+
+int log_block_decode(const log_codec_t *c, const uint8_t *in, size_t len, uint8_t *recs, uint16_t max, size_t *used) {
+    if (len < LOG_BLOCK_HDR_SIZE || get_field(in, 2) != LOG_BLOCK_MAGIC) return -1;
+    uint16_t n = get_field(in + 2, 2);
+    size_t payload = get_field(in + 4, 2);
+    if (n > max || LOG_BLOCK_HDR_SIZE + payload > len) return -1;
+    const uint8_t *p = in + LOG_BLOCK_HDR_SIZE, *end = p + payload;
+    if (log_crc32(p, payload) != get_field(in + 8, 4)) return -1;
+
+    uint32_t prev[LOG_CODEC_MAX_FIELDS] = {0};
+    for (uint16_t r = 0; r < n; r++, recs += c->rec_size) {
+        for (uint8_t f = 0; f < c->n_fields; f++) {
+            uint32_t z = 0;
+            for (int s = 0; ; s += 7) {
+                if (p == end || s > 28) return -1;
+                z |= (uint32_t)(*p & 0x7F) << s;
+                if (!(*p++ & 0x80)) break;
+            }
+            int32_t d = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+            prev[f] += (uint32_t)d;
+            put_field(recs + c->off[f], c->width[f], prev[f]);
+        }
+    }
+    if (p != end) return -1;    // Payload tem que fechar exatamente
+    if (used) *used = LOG_BLOCK_HDR_SIZE + payload;
+    return n;
+}
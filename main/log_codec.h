@@ -0,0 +1,40 @@
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Codec de blocos do log: registros de tamanho fixo vistos como campos
+// inteiros LE (larguras de 1, 2 ou 4 bytes). Cada campo vira a diferença
+// para o registro anterior, em zigzag + varint; amostras seguidas mudam
+// pouco, então a maioria dos campos cabe em 1 byte. O delta recomeça do
+// zero em cada bloco: todo bloco decodifica sozinho (seek por volta e
+// recuperação depois de um corte de energia).
+//
+// Bloco, little-endian:
+//   0  u16 magic LOG_BLOCK_MAGIC   2  u16 nº de registros
+//   4  u16 bytes do payload        6  u16 reservado
+//   8  u32 CRC-32 (IEEE) do payload
+//   12 payload: n registros x n campos varints
+#define LOG_BLOCK_MAGIC       0xB10C
+#define LOG_BLOCK_HDR_SIZE    12
+#define LOG_CODEC_MAX_FIELDS  16
+
+typedef struct {
+    uint8_t n_fields, rec_size;
+    uint8_t off[LOG_CODEC_MAX_FIELDS], width[LOG_CODEC_MAX_FIELDS];
+} log_codec_t;
+
+// Pior caso de um bloco de 'n' registros (varint de 32 bits = 5 bytes)
+#define LOG_BLOCK_MAX_SIZE(c, n) (LOG_BLOCK_HDR_SIZE + (size_t)(n) * (c)->n_fields * 5)
+
+bool log_codec_init(log_codec_t *c, const uint8_t *widths, uint8_t n_fields);
+// Retorna o tamanho do bloco em 'out' (0 = não coube em 'cap')
+size_t log_block_encode(const log_codec_t *c, const uint8_t *recs, uint16_t n, uint8_t *out, size_t cap);
+// Valida e decodifica o bloco no início de 'in'. Retorna o nº de
+// registros (-1 = bloco inválido/incompleto) e o tamanho do bloco em 'used'.
+int log_block_decode(const log_codec_t *c, const uint8_t *in, size_t len, uint8_t *recs, uint16_t max, size_t *used);
+uint32_t log_crc32(const uint8_t *p, size_t n);
+
+#endif
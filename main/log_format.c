@@ -0,0 +1,88 @@
+#include "log_format.h"
+#include <string.h>
+
+typedef struct {
+    const char *name, *unit;
+    uint8_t type, offset, shift, bits;
+    int8_t exp;
+} log_chan_t;
+
+static const log_chan_t channels[] = {
+    { "t_ms",  "ms",  LOG_U32, 0,  0, 0,  0 },
+    { "lat",   "deg", LOG_I32, 4,  0, 0, -7 },
+    { "lon",   "deg", LOG_I32, 8,  0, 0, -7 },
+    { "speed", "m/s", LOG_U16, 12, 0, 0, -2 },
+    { "lap",   "",    LOG_U8,  14, 0, 0,  0 },
+    { "mode",  "",    LOG_U8,  15, 0, 1,  0 },
+    { "seq",   "",    LOG_U8,  15, 4, 4,  0 },
+};
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put_u32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static uint32_t get_u32(const uint8_t *p) { return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+size_t log_build_header(uint8_t *out, uint16_t session_id, const gps_data_t *start, uint8_t flags) {
+    const size_t n = sizeof(channels) / sizeof(channels[0]);
+    memset(out, 0, LOG_HDR_SIZE);
+    memcpy(out, LOG_MAGIC, 4);
+    put_u16(out + 4, LOG_VERSION);
+    put_u16(out + 6, LOG_HDR_SIZE);
+    put_u16(out + 8, LOG_REC_SIZE);
+    out[10] = (uint8_t)n;
+    out[11] = flags;
+    put_u16(out + 12, session_id);
+    if (start->valid) {
+        out[14] = start->year; out[15] = start->month; out[16] = start->day;
+        out[17] = start->hour; out[18] = start->minute; out[19] = start->second;
+    }
+    put_u32(out + 20, start->timestamp_ms);
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *c = out + 32 + i * LOG_CHAN_SIZE;
+        strncpy((char *)c, channels[i].name, 15);
+        strncpy((char *)c + 16, channels[i].unit, 7);
+        c[24] = channels[i].type;
+        c[25] = channels[i].offset;
+        c[26] = channels[i].shift;
+        c[27] = channels[i].bits;
+        c[28] = (uint8_t)channels[i].exp;
+    }
+    return LOG_HDR_SIZE;
+}
+
+uint8_t log_field_widths(uint8_t *widths) {
+    static const uint8_t type_size[] = { [LOG_U8] = 1, [LOG_U16] = 2, [LOG_U32] = 4, [LOG_I8] = 1, [LOG_I16] = 2, [LOG_I32] = 4 };
+    uint8_t n = 0, next = 0;
+    for (size_t i = 0; i < sizeof(channels) / sizeof(channels[0]); i++) {
+        if (channels[i].offset < next) continue;   // Mesmo byte de um bitfield anterior
+        widths[n++] = type_size[channels[i].type];
+        next = channels[i].offset + type_size[channels[i].type];
+    }
+    return n;
+}
+
+_Static_assert(sizeof(log_lap_index_t) == 12, "entrada do índice mudou de tamanho");
+
+size_t log_build_index_header(uint8_t *out, uint32_t n_entries) {
+    memset(out, 0, LOG_IDX_HDR_SIZE);
+    memcpy(out, LOG_IDX_MAGIC, 4);
+    put_u16(out + 4, LOG_IDX_VERSION);
+    put_u16(out + 6, sizeof(log_lap_index_t));
+    put_u32(out + 8, n_entries);
+    return LOG_IDX_HDR_SIZE;
+}
+
+void log_encode_sample(uint8_t *out, const gps_data_t *g, race_mode_t mode, uint16_t lap, uint8_t seq) {
+    int32_t cms = (g->speed_mms + 5) / 10;
+    put_u32(out, g->timestamp_ms);
+    put_u32(out + 4, (uint32_t)g->lat_e7);
+    put_u32(out + 8, (uint32_t)g->lon_e7);
+    put_u16(out + 12, (uint16_t)(cms < 0 ? 0 : cms > 0xFFFF ? 0xFFFF : cms));
+    out[14] = (uint8_t)(lap > 0xFF ? 0xFF : lap);
+    out[15] = (uint8_t)((mode == MODE_CORRIDA ? 1 : 0) | (seq & LOG_SEQ_MASK) << 4);
+}
+
+bool log_record_follows(const uint8_t *prev, const uint8_t *rec) {
+    if ((((prev[15] >> 4) + 1) & LOG_SEQ_MASK) != (rec[15] >> 4)) return false;
+    uint32_t dt = get_u32(rec) - get_u32(prev);
+    return dt <= LOG_MAX_GAP_MS;
+}
@@ -0,0 +1,70 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "telemetry_gps.h"
+
+// Log binário da sessão (data_<sessão>.kbl). Cabeçalho autodescritivo
+// seguido de registros de tamanho fixo, tudo little-endian:
+//
+//   0   "KBLG"
+//   4   u16 versão          6  u16 tamanho do cabeçalho
+//   8   u16 tamanho do registro
+//   10  u8  nº de canais    11 u8  flags (LOG_FLAG_*)
+//   12  u16 id da sessão
+//   14  u8  ano, mês, dia, hora, minuto, segundo (hora local da 1a fix)
+//   20  u32 timestamp_ms da 1a fix (mesmo relógio do canal t_ms)
+//   24  u32 bytes confirmados no cartão (atualizado a cada fsync; no
+//       fechamento é o tamanho final; 0 = nunca sincronizado)
+//   28  reservado até 32
+//   32  descritores de canal, 32 bytes cada:
+//         nome[16], unidade[8], tipo, offset, shift, bits, expoente, res[3]
+//
+// Valor do canal = ((bruto >> shift) & máscara(bits)) * 10^expoente.
+//
+// Com LOG_FLAG_BLOCKS o corpo não são registros soltos, e sim blocos do
+// log_codec.h. Os campos do codec saem dos descritores: cada offset
+// distinto vira um campo do tamanho do tipo (bitfields dividem o byte).
+#define LOG_MAGIC         "KBLG"
+#define LOG_VERSION       1
+#define LOG_CHAN_SIZE     32
+#define LOG_HDR_SIZE      256   // 32 + 7 canais, completado até 256
+#define LOG_REC_SIZE      16
+#define LOG_LEN_OFFSET    24
+#define LOG_FLAG_BLOCKS   0x01  // Corpo comprimido em blocos (delta + varint)
+
+typedef enum { LOG_U8 = 1, LOG_U16, LOG_U32, LOG_I8, LOG_I16, LOG_I32 } log_type_t;
+
+// Registro de amostra (offsets em bytes):
+//   0 u32 t_ms   4 i32 lat_e7   8 i32 lon_e7   12 u16 velocidade cm/s
+//   14 u8 volta  15 u8 flags: bit0 modo (1 = RACE), bits 4-7 sequência
+#define LOG_SEQ_MASK      0x0F
+#define LOG_MAX_GAP_MS    10000 // Salto máximo de t_ms entre registros seguidos
+
+// Índice de voltas (idx_<sessão>.kbi), gravado no fim da sessão: onde
+// começa cada volta no .kbl, para ler uma volta com um só seek.
+//   0   "KBLI"
+//   4   u16 versão          6  u16 tamanho da entrada
+//   8   u32 nº de entradas  12 reservado até 16
+//   16  entradas: u16 volta (contagem inteira; o canal lap satura em 255), u16 res.,
+//       u32 offset do 1o registro, u32 nº de registros
+#define LOG_IDX_MAGIC     "KBLI"
+#define LOG_IDX_VERSION   1
+#define LOG_IDX_HDR_SIZE  16
+
+typedef struct { uint16_t lap; uint16_t reserved; uint32_t offset; uint32_t count; } log_lap_index_t;
+
+size_t log_build_header(uint8_t *out, uint16_t session_id, const gps_data_t *start, uint8_t flags);
+// Larguras dos campos do registro para o log_codec (retorna quantos)
+uint8_t log_field_widths(uint8_t *widths);
+size_t log_build_index_header(uint8_t *out, uint32_t n_entries);
+void log_encode_sample(uint8_t *out, const gps_data_t *g, race_mode_t mode, uint16_t lap, uint8_t seq);
+
+// Recuperação: 'rec' continua a cadeia de 'prev' (sequência seguinte e
+// t_ms avançando pouco)? Serve para separar dados reais do lixo que
+// sobra na área pré-alocada depois de um desligamento.
+bool log_record_follows(const uint8_t *prev, const uint8_t *rec);
+
+#endif
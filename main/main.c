@@ -9,17 +9,23 @@
 #include "esp_lvgl_port.h"
 #include "config.h"
 #include "telemetry_gps.h"
+#include "telemetry_mpu.h"
+#include "telemetry_fusion.h"
 #include "telemetry_sd.h"
+#include "track_db.h"
 #include "ui_kartbox.h"
 
 bool recording_active = false; 
 static uint32_t reset_press_start = 0;
 static int last_mode_state = 1;
 static int last_line_state = 1;
+static uint32_t line_press_start = 0;
+static bool line_hold_done = false;
 
 void end_race_session(void) {
     if (recording_active) {
         sd_stop_session();
+        gps_save_track(); // Linha manual numa pista nova vira registro (na writer_task, sem esperar)
         recording_active = false; 
         gps_reset_session();
         if (lvgl_port_lock(0)) {
@@ -47,10 +53,12 @@ void app_main(void) {
     };
     gpio_config(&b_cfg);
 
-    gps_init();
+    gps_init(GPS_PROTOCOL);
+    mpu_init(); // Sem o sensor, os canais de G seguem zerados
     
     // Inicializa o SD e atualiza a interface se montado
     if (sd_init()) {
+        track_db_open(TRACK_DB_PATH); // Sem o arquivo, o banco nasce na 1a pista gravada
         if (lvgl_port_lock(0)) {
             ui_update_sd_info(); // MOSTRA O TAMANHO REAL DO CARTÃO AQUI
             ui_refresh_session_dropdown();
@@ -59,14 +67,29 @@ void app_main(void) {
     }
 
     uint32_t last_ui = 0;
+    gps_reader_t gps_rd;
+    gps_reader_init(&gps_rd);
+    fusion_init();
 
     while (1) {
-        gps_data_t cur = gps_get_latest();
-        gps_process_timing(&cur);
-        
-        if (recording_active) {
-            sd_log_sample(cur, (mpu_data_t){0}, gps_get_mode(), gps_get_lap_count());
+        // Cada fix nova passa uma única vez pelo cronômetro e pelo log
+        gps_data_t fix;
+        while (gps_read_fix(&gps_rd, &fix)) {
+            char track[TRACK_NAME_LEN];
+            if (!recording_active && gps_auto_arm(&fix, track, sizeof(track))) {
+                recording_active = true;
+                if (lvgl_port_lock(0)) { ui_show_popup(track, 2000); lvgl_port_unlock(); }
+            }
+            mpu_calib_feed(&fix);
+            fusion_feed_fix(&fix);
+            if (!fusion_active()) gps_process_timing(&fix);
+            if (recording_active) {
+                sd_log_sample(fix, mpu_get_data(), gps_get_mode(), gps_get_lap_count());
+            }
         }
+        // Com a fusão ativa, o cronômetro anda a cada amostra da IMU (100 Hz)
+        gps_data_t fused;
+        while (fusion_next(&fused)) gps_process_timing(&fused);
 
         // --- BOTÃO MODO ---
         int mode_val = gpio_get_level(BTN_MODE_PIN);
@@ -77,8 +100,19 @@ void app_main(void) {
         last_mode_state = mode_val;
 
         // --- BOTÃO LINHA ---
+        // Toque marca a chegada (ao soltar); segurado marca uma parcial no lugar
         int line_val = gpio_get_level(BTN_SETLINE_PIN);
+        uint32_t line_now = esp_timer_get_time() / 1000;
         if (last_line_state == 1 && line_val == 0) {
+            line_press_start = line_now;
+            line_hold_done = false;
+        }
+        if (line_val == 0 && !line_hold_done && line_now - line_press_start >= SPLIT_HOLD_MS) {
+            line_hold_done = true;
+            bool ok = gps_add_split_gate();
+            if (lvgl_port_lock(0)) { ui_show_popup(ok ? "PARCIAL MARCADA" : "SEM LINHA/GPS", 1500); lvgl_port_unlock(); }
+        }
+        if (last_line_state == 0 && line_val == 1 && !line_hold_done) {
             if (gps_set_finish_line()) {
                 recording_active = true;
                 if (lvgl_port_lock(0)) { ui_show_popup("GRAVANDO...", 1500); lvgl_port_unlock(); }
@@ -109,7 +143,7 @@ void app_main(void) {
         uint32_t now = esp_timer_get_time() / 1000;
         if (now - last_ui >= UI_UPDATE_MS) {
             if (lvgl_port_lock(0)) {
-                ui_update(cur, (mpu_data_t){0}, gps_get_current_time_ms(), gps_get_last_lap(), gps_get_best_lap(), gps_get_lap_count(), sd_get_current_session_id());
+                ui_update(fusion_active() ? fusion_get_latest() : gps_get_latest(), mpu_get_data(), gps_get_current_time_ms(), gps_get_last_lap(), gps_get_best_lap(), gps_get_lap_count(), sd_get_current_session_id());
                 lvgl_port_unlock();
             }
             last_ui = now;
@@ -0,0 +1,71 @@
+#include "mpu6050.h"
+
+static int wr(const mpu_bus_t *bus, uint8_t reg, uint8_t v) { return bus->write(bus->ctx, reg, &v, 1); }
+
+bool mpu6050_configure(const mpu_bus_t *bus, const mpu_config_t *cfg) {
+    uint8_t who = 0;
+    if (bus->read(bus->ctx, MPU_REG_WHO_AM_I, &who, 1) != 0 || who != MPU6050_WHO_AM_I_VAL) return false;
+
+    uint8_t dlpf = cfg->dlpf_cfg ? cfg->dlpf_cfg : 1;   // Sem DLPF o FIFO encheria a 8 kHz
+    uint16_t hz = cfg->sample_hz ? cfg->sample_hz : 1000;
+    uint16_t div = 1000 / hz;
+    if (div == 0) div = 1;
+    if (div > 256) div = 256;
+
+    int err = 0;
+    err |= wr(bus, MPU_REG_PWR_MGMT_1, 0x01);           // Acorda, relógio do PLL do giro X
+    err |= wr(bus, MPU_REG_CONFIG, dlpf & 0x07);
+    err |= wr(bus, MPU_REG_SMPLRT_DIV, (uint8_t)(div - 1));
+    err |= wr(bus, MPU_REG_GYRO_CONFIG, (cfg->gyro_fs & 3) << 3);
+    err |= wr(bus, MPU_REG_ACCEL_CONFIG, (cfg->accel_fs & 3) << 3);
+    err |= wr(bus, MPU_REG_INT_PIN_CFG, 0x10);          // Pulso de 50 us, limpa em qualquer leitura
+    err |= wr(bus, MPU_REG_INT_ENABLE, cfg->int_data_ready ? MPU_INT_DATA_RDY : 0);
+    err |= wr(bus, MPU_REG_FIFO_EN, 0x78);              // XG, YG, ZG e ACCEL
+    err |= wr(bus, MPU_REG_USER_CTRL, 0x04);            // Zera o FIFO...
+    err |= wr(bus, MPU_REG_USER_CTRL, 0x40);            // ...e liga
+    return err == 0;
+}
+
+static int16_t be16(const uint8_t *p) { return (int16_t)((uint16_t)p[0] << 8 | p[1]); }
+
+int mpu6050_fifo_read(const mpu_bus_t *bus, mpu_raw_t *out, int max, size_t burst) {
+    uint8_t st, cnt[2];
+    if (bus->read(bus->ctx, MPU_REG_INT_STATUS, &st, 1) != 0) return -1;
+    if (st & MPU_INT_FIFO_OFLOW) {
+        // FIFO cheio sobrescreve amostras e desalinha os quadros: recomeça
+        wr(bus, MPU_REG_USER_CTRL, 0x44);
+        return -2;
+    }
+    if (bus->read(bus->ctx, MPU_REG_FIFO_COUNTH, cnt, 2) != 0) return -1;
+    int n = (cnt[0] << 8 | cnt[1]) / MPU_FIFO_FRAME;    // Quadro pela metade fica para a próxima
+    if (n > max) n = max;
+
+    int per_burst = (int)(burst / MPU_FIFO_FRAME);
+    if (per_burst < 1) per_burst = 1;
+    uint8_t buf[40 * MPU_FIFO_FRAME];  // Rajada maior que isso vira várias
+    for (int done = 0; done < n; ) {
+        int k = n - done;
+        if (k > per_burst) k = per_burst;
+        if (k * MPU_FIFO_FRAME > (int)sizeof(buf)) k = sizeof(buf) / MPU_FIFO_FRAME;
+        if (bus->read(bus->ctx, MPU_REG_FIFO_R_W, buf, (size_t)k * MPU_FIFO_FRAME) != 0) return done ? done : -1;
+        for (int i = 0; i < k; i++) {
+            const uint8_t *f = buf + i * MPU_FIFO_FRAME;
+            mpu_raw_t *s = &out[done + i];
+            for (int a = 0; a < 3; a++) {
+                s->acc[a] = be16(f + 2 * a);
+                s->gyro[a] = be16(f + 6 + 2 * a);
+            }
+        }
+        done += k;
+    }
+    return n;
+}
+
+uint32_t mpu6050_burst_t0(uint32_t t_ready, uint32_t t_read, uint32_t period_us, bool use_int, int n) {
+    uint32_t t_new = t_ready;
+    if (!use_int || (int32_t)(t_read - t_ready) > (int32_t)(2 * period_us)) t_new = t_read;
+    return t_new - (uint32_t)(n > 0 ? n - 1 : 0) * period_us;
+}
+
+float mpu6050_accel_lsb(uint8_t accel_fs) { return 16384.0f / (float)(1 << (accel_fs & 3)); }
+float mpu6050_gyro_lsb(uint8_t gyro_fs) { return 131.0f / (float)(1 << (gyro_fs & 3)); }
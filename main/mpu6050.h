@@ -0,0 +1,68 @@
+#ifndef MPU6050_H
+#define MPU6050_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MPU6050_ADDR            0x68
+#define MPU6050_WHO_AM_I_VAL    0x68
+
+// Registradores usados
+#define MPU_REG_SMPLRT_DIV      0x19
+#define MPU_REG_CONFIG          0x1A
+#define MPU_REG_GYRO_CONFIG     0x1B
+#define MPU_REG_ACCEL_CONFIG    0x1C
+#define MPU_REG_FIFO_EN         0x23
+#define MPU_REG_INT_PIN_CFG     0x37
+#define MPU_REG_INT_ENABLE      0x38
+#define MPU_REG_INT_STATUS      0x3A
+#define MPU_REG_USER_CTRL       0x6A
+#define MPU_REG_PWR_MGMT_1      0x6B
+#define MPU_REG_FIFO_COUNTH     0x72
+#define MPU_REG_FIFO_R_W        0x74
+#define MPU_REG_WHO_AM_I        0x75
+
+#define MPU_FIFO_SIZE           1024
+#define MPU_FIFO_FRAME          12      // Acel XYZ + giro XYZ, big-endian
+#define MPU_INT_FIFO_OFLOW      0x10
+#define MPU_INT_DATA_RDY        0x01
+
+// Acesso ao sensor: I2C no firmware, simulação no host. Retornam 0 em
+// sucesso; read lê 'len' bytes a partir de 'reg' numa só transação.
+typedef struct {
+    int (*write)(void *ctx, uint8_t reg, const uint8_t *data, size_t len);
+    int (*read)(void *ctx, uint8_t reg, uint8_t *data, size_t len);
+    void *ctx;
+} mpu_bus_t;
+
+typedef struct {
+    uint16_t sample_hz;         // Com DLPF ligado o giro amostra a 1 kHz
+    uint8_t dlpf_cfg;           // 1..6 (0 desliga o DLPF e muda o giro para 8 kHz)
+    uint8_t accel_fs, gyro_fs;  // 0..3
+    bool int_data_ready;        // Pulso no pino INT a cada amostra
+} mpu_config_t;
+
+// Amostra bruta, nos eixos do sensor
+typedef struct { int16_t acc[3]; int16_t gyro[3]; } mpu_raw_t;
+
+// Acorda, confere o WHO_AM_I e liga DLPF, divisor, escalas e o FIFO
+// (acel + giro). false = sensor ausente ou barramento com erro.
+bool mpu6050_configure(const mpu_bus_t *bus, const mpu_config_t *cfg);
+
+// Esvazia o FIFO em rajadas de até 'burst' bytes. Retorna as amostras
+// lidas, -1 em erro de barramento, ou -2 se o FIFO transbordou (foi
+// zerado e as amostras daquele intervalo se perderam).
+int mpu6050_fifo_read(const mpu_bus_t *bus, mpu_raw_t *out, int max, size_t burst);
+
+// Instante (us) da 1a de 'n' amostras lidas juntas; a i-ésima fica em
+// +i*period_us. A mais nova é a do último data-ready 't_ready', ou a da
+// leitura 't_read' sem o fio do INT ou com o pulso parado há mais de dois
+// períodos. Relógio de 32 bits: a volta do contador não atrapalha.
+uint32_t mpu6050_burst_t0(uint32_t t_ready, uint32_t t_read, uint32_t period_us, bool use_int, int n);
+
+// LSB por g e por °/s de cada escala
+float mpu6050_accel_lsb(uint8_t accel_fs);
+float mpu6050_gyro_lsb(uint8_t gyro_fs);
+
+#endif
@@ -0,0 +1,109 @@
+#include "sd_manifest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(sd_session_t) == 80, "entrada do manifesto mudou de tamanho");
+
+static char mf_path[64];
+static sd_session_t *list = NULL;   // Ordem de criação (id crescente)
+static int n_list = 0, cap_list = 0;
+
+// Busca do fim: a sessão atualizada quase sempre é a última
+static int mf_index(uint16_t id) {
+    for (int i = n_list - 1; i >= 0; i--) if (list[i].id == id) return i;
+    return -1;
+}
+
+static bool mf_apply(const sd_session_t *s) {
+    int i = mf_index(s->id);
+    if (i >= 0) { list[i] = *s; return true; }
+    if (n_list == cap_list) {
+        int cap = cap_list ? cap_list * 2 : 64;
+        sd_session_t *p = realloc(list, (size_t)cap * sizeof(sd_session_t));
+        if (!p) return false;
+        list = p;
+        cap_list = cap;
+    }
+    list[n_list++] = *s;
+    return true;
+}
+
+// Reescreve só com a entrada final de cada sessão. FAT não sobrescreve no
+// rename: o manifesto antigo vira .bak até o novo estar no lugar, e o
+// mf_recover resolve um corte entre os renames.
+static void mf_compact(void) {
+    char tmp[72], bak[72];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", mf_path);
+    snprintf(bak, sizeof(bak), "%s.bak", mf_path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return;
+    bool ok = fwrite(list, sizeof(sd_session_t), n_list, f) == (size_t)n_list;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) { remove(tmp); return; }
+    remove(bak);
+    if (rename(mf_path, bak) != 0) { remove(tmp); return; }
+    if (rename(tmp, mf_path) != 0) { rename(bak, mf_path); remove(tmp); return; }
+    remove(bak);
+}
+
+// Sobras do mf_compact. Com o manifesto no lugar, .tmp e .bak são lixo.
+// Sem ele, o .bak só existe depois do .tmp fechado e completo: o .tmp
+// vale se ainda estiver lá, senão volta o .bak.
+static void mf_recover(void) {
+    char tmp[72], bak[72];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", mf_path);
+    snprintf(bak, sizeof(bak), "%s.bak", mf_path);
+    FILE *f = fopen(mf_path, "rb");
+    if (f) { fclose(f); remove(tmp); remove(bak); return; }
+    f = fopen(bak, "rb");
+    if (!f) { remove(tmp); return; }
+    fclose(f);
+    if (rename(tmp, mf_path) == 0) remove(bak);
+    else rename(bak, mf_path);
+}
+
+bool sd_manifest_load(const char *path) {
+    snprintf(mf_path, sizeof(mf_path), "%s", path);
+    n_list = 0;
+    mf_recover();
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    int n = (int)(size / (long)sizeof(sd_session_t)); // Entrada cortada no fim é ignorada
+    sd_session_t *raw = n ? malloc((size_t)n * sizeof(sd_session_t)) : NULL;
+    if (raw) n = (int)fread(raw, sizeof(sd_session_t), n, f);
+    fclose(f);
+    for (int i = 0; raw && i < n; i++) mf_apply(&raw[i]);
+    free(raw);
+    if (n > 2 * n_list + 32) mf_compact();
+    return true;
+}
+
+bool sd_manifest_put(const sd_session_t *s) {
+    if (!mf_path[0] || !mf_apply(s)) return false;
+    FILE *f = fopen(mf_path, "ab");
+    if (!f) return false;
+    bool ok = fwrite(s, sizeof(*s), 1, f) == 1;
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+int sd_manifest_count(void) { return n_list; }
+
+const sd_session_t *sd_manifest_get(int idx) {
+    if (idx < 0 || idx >= n_list) return NULL;
+    return &list[n_list - 1 - idx];
+}
+
+const sd_session_t *sd_manifest_find(uint16_t id) {
+    int i = mf_index(id);
+    return (i >= 0) ? &list[i] : NULL;
+}
+
+void sd_manifest_clear(void) {
+    n_list = 0;
+    if (mf_path[0]) remove(mf_path);
+}
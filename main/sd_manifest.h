@@ -0,0 +1,37 @@
+#ifndef SD_MANIFEST_H
+#define SD_MANIFEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SD_SESSION_NAME_LEN  24
+#define SD_SESSION_TRACK_LEN 32
+
+typedef enum { SD_SESSION_OPEN = 1, SD_SESSION_CLOSED = 2 } sd_session_state_t;
+
+// Entrada do manifesto (80 bytes, gravada como está: arquivo só do KartBox)
+typedef struct {
+    uint16_t id;
+    uint8_t state;                      // sd_session_state_t
+    uint8_t reserved;
+    char name[SD_SESSION_NAME_LEN];     // data_<name>.kbl / laps_<name>.csv
+    uint8_t year, month, day, hour, minute, second;
+    uint16_t laps;
+    uint32_t best_ms;
+    uint32_t bytes;                     // Tamanho final do log de amostras
+    char track[SD_SESSION_TRACK_LEN];
+    uint32_t reserved2;
+} sd_session_t;
+
+// Manifesto só de acréscimo: cada início e fim de sessão grava a entrada
+// inteira no final do arquivo, e a última entrada de cada id vale. Na
+// carga tudo vai para a RAM com um fread; listar e abrir viram acesso
+// direto por índice, sem varrer o diretório.
+bool sd_manifest_load(const char *path);    // false = arquivo ainda não existe
+bool sd_manifest_put(const sd_session_t *s); // Acrescenta/atualiza
+int sd_manifest_count(void);
+const sd_session_t *sd_manifest_get(int idx); // 0 = sessão mais recente
+const sd_session_t *sd_manifest_find(uint16_t id);
+void sd_manifest_clear(void);
+
+#endif
@@ -0,0 +1,113 @@
+#include "sd_summary.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+_Static_assert(sizeof(sd_lap_summary_t) == 8, "registro de volta mudou de tamanho");
+
+void sd_summary_reset(sd_summary_t *s) {
+    sd_lap_summary_t *laps = s->laps;
+    uint16_t cap = s->cap;
+    memset(&s->hdr, 0, sizeof(s->hdr));
+    s->laps = laps;                     // Reaproveita o vetor da sessão anterior
+    s->cap = cap;
+}
+
+void sd_summary_free(sd_summary_t *s) {
+    free(s->laps);
+    memset(s, 0, sizeof(*s));
+}
+
+bool sd_summary_add_lap(sd_summary_t *s, uint32_t ms, float avg_kmh, float max_kmh, const uint32_t *sectors, uint8_t n_sectors) {
+    sd_summary_hdr_t *h = &s->hdr;
+    if (h->n_laps == s->cap) {
+        if (s->cap == UINT16_MAX) return false;
+        uint32_t cap = s->cap ? s->cap * 2u : 64u;
+        if (cap > UINT16_MAX) cap = UINT16_MAX;
+        sd_lap_summary_t *p = realloc(s->laps, cap * sizeof(sd_lap_summary_t));
+        if (!p) return false;
+        s->laps = p;
+        s->cap = (uint16_t)cap;
+    }
+    s->laps[h->n_laps++] = (sd_lap_summary_t){ .ms = ms,
+        .avg_kmh10 = (uint16_t)(avg_kmh * 10.0f + 0.5f), .max_kmh10 = (uint16_t)(max_kmh * 10.0f + 0.5f) };
+    if (h->best_ms == 0 || ms < h->best_ms) { h->best_ms = ms; h->best_lap = h->n_laps; }
+
+    // Melhores setores só entre voltas completas (mesma quantidade de setores)
+    if (n_sectors > SECTOR_MAX) n_sectors = SECTOR_MAX;
+    if (n_sectors > h->n_sectors) { h->n_sectors = n_sectors; memset(h->best_sector_ms, 0, sizeof(h->best_sector_ms)); }
+    if (n_sectors && n_sectors == h->n_sectors) {
+        for (uint8_t i = 0; i < n_sectors; i++) {
+            if (h->best_sector_ms[i] == 0 || sectors[i] < h->best_sector_ms[i]) h->best_sector_ms[i] = sectors[i];
+        }
+    }
+    return true;
+}
+
+void sd_summary_finish(sd_summary_t *s) {
+    sd_summary_hdr_t *h = &s->hdr;
+    const sd_lap_summary_t *laps = s->laps;
+    memcpy(h->magic, "KBSM", 4);
+    h->version = SD_SUMMARY_VERSION;
+    h->hdr_size = sizeof(*h);
+
+    h->ideal_ms = 0;
+    for (uint8_t i = 0; i < h->n_sectors; i++) h->ideal_ms += h->best_sector_ms[i];
+
+    // Volta de saída, box e bandeira amarela ficam fora da consistência
+    uint32_t limit = (uint32_t)((uint64_t)h->best_ms * SD_CONSIST_PCT / 100);
+    double sum = 0, sum2 = 0;
+    h->n_consistent = 0;
+    for (uint16_t i = 0; i < h->n_laps; i++) {
+        if (laps[i].ms > limit) continue;
+        sum += laps[i].ms;
+        sum2 += (double)laps[i].ms * laps[i].ms;
+        h->n_consistent++;
+    }
+    h->mean_ms = h->stdev_ms = 0;
+    if (h->n_consistent) {
+        double mean = sum / h->n_consistent;
+        double var = sum2 / h->n_consistent - mean * mean;
+        h->mean_ms = (uint32_t)(mean + 0.5);
+        h->stdev_ms = var > 0 ? (uint32_t)(sqrt(var) + 0.5) : 0;
+    }
+}
+
+bool sd_summary_write(sd_summary_t *s, const char *path) {
+    sd_summary_finish(s);
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(&s->hdr, sizeof(s->hdr), 1, f) == 1;
+    if (ok && s->hdr.n_laps) ok = fwrite(s->laps, sizeof(sd_lap_summary_t), s->hdr.n_laps, f) == s->hdr.n_laps;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) remove(path);
+    return ok;
+}
+
+bool sd_summary_read(sd_summary_t *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *raw = size >= (long)sizeof(sd_summary_hdr_t) ? malloc(size) : NULL;
+    bool ok = raw && fread(raw, 1, size, f) == (size_t)size;
+    fclose(f);
+    if (!ok) { free(raw); return false; }
+
+    // Versões futuras podem crescer o cabeçalho: as voltas começam em hdr_size
+    sd_summary_hdr_t *h = (sd_summary_hdr_t *)raw;
+    if (memcmp(h->magic, "KBSM", 4) != 0 || h->hdr_size < sizeof(*h) ||
+        h->hdr_size + (long)h->n_laps * (long)sizeof(sd_lap_summary_t) > size) {
+        free(raw);
+        return false;
+    }
+    s->hdr = *h;
+    memmove(raw, raw + h->hdr_size, s->hdr.n_laps * sizeof(sd_lap_summary_t));
+    s->laps = (sd_lap_summary_t *)raw;
+    s->cap = s->hdr.n_laps;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SD_SUMMARY_H
+#define SD_SUMMARY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "track_sectors.h"
+
+#define SD_SUMMARY_VERSION 1
+
+// Resumo da sessão (sum_<name>.kbs), gravado no fim da sessão: cabeçalho
+// com os números da aba VOLTAS já prontos, seguido de um registro por
+// volta. Structs gravadas como estão (arquivo só do KartBox, LE).
+typedef struct {
+    char magic[4];                      // "KBSM"
+    uint16_t version, hdr_size;
+    uint16_t n_laps, best_lap;
+    uint32_t best_ms;
+    uint32_t ideal_ms;                  // Soma dos melhores setores (0 = sem setores)
+    uint32_t mean_ms, stdev_ms;         // Consistência: só voltas até SD_CONSIST_PCT% da melhor
+    uint16_t n_consistent;
+    uint8_t n_sectors, reserved;
+    uint32_t best_sector_ms[SECTOR_MAX];
+} sd_summary_hdr_t;
+
+typedef struct {
+    uint32_t ms;
+    uint16_t avg_kmh10, max_kmh10;      // Décimos de km/h (max 0 = desconhecida)
+} sd_lap_summary_t;
+
+typedef struct {
+    sd_summary_hdr_t hdr;
+    sd_lap_summary_t *laps;
+    uint16_t cap;
+} sd_summary_t;
+
+void sd_summary_reset(sd_summary_t *s);
+void sd_summary_free(sd_summary_t *s);
+bool sd_summary_add_lap(sd_summary_t *s, uint32_t ms, float avg_kmh, float max_kmh, const uint32_t *sectors, uint8_t n_sectors);
+// Calcula ideal e consistência e preenche magic/versão do cabeçalho
+void sd_summary_finish(sd_summary_t *s);
+// Fecha as estatísticas e grava cabeçalho + voltas
+bool sd_summary_write(sd_summary_t *s, const char *path);
+// Um fread do arquivo inteiro; as voltas ficam no próprio bloco lido
+// (liberar com sd_summary_free)
+bool sd_summary_read(sd_summary_t *s, const char *path);
+
+#endif
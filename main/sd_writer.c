@@ -0,0 +1,279 @@
+#include "sd_writer.h"
+#include "config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <unistd.h>
+#include <string.h>
+
+typedef enum { WR_BLOCK, WR_SYNC, WR_AUX, WR_JOB, WR_CLOSE } wr_cmd_t;
+typedef struct {
+    uint8_t cmd; uint8_t buf; uint32_t len; uint32_t off;
+    uint32_t from;                // Só WR_SYNC: início do trecho dentro do buffer
+    void (*job)(const void *arg); // Só WR_JOB
+    uint8_t aux[SD_AUX_LINE_MAX]; // WR_AUX: a linha; WR_JOB: o argumento (copiado)
+} wr_msg_t;
+
+#define WR_AUX_SLOTS 4
+#define WR_SECTOR    512
+
+static const char *TAG = "SD_WR";
+static uint8_t *bufs[SD_LOG_BUF_COUNT];
+static QueueHandle_t full_q = NULL;     // Produtor -> writer_task (blocos e comandos)
+static QueueHandle_t free_q = NULL;     // writer_task -> produtor (buffers livres)
+static SemaphoreHandle_t done_sem = NULL;
+static int wr_fd = -1;                  // Só a writer_task usa enquanto aberto
+static uint32_t wr_reserved = 0;        // Tamanho pré-alocado (0 = arquivo cresce normal)
+static int32_t wr_len_field = -1;
+static uint32_t wr_committed = 0;       // Último tamanho confirmado (só a writer_task)
+static int aux_fd = -1;
+static uint32_t aux_inflight = 0;       // Linhas na fila (limitadas a WR_AUX_SLOTS)
+static bool job_inflight = false;       // Uma tarefa avulsa por vez (vaga própria na fila)
+static bool is_open = false;
+static int active = -1;                 // Buffer sendo preenchido pelo produtor
+static uint32_t fill = 0;
+static uint32_t active_off = 0;         // Posição no arquivo do início do buffer ativo
+static uint32_t queued = 0;             // Bytes entregues e ainda não gravados
+static uint32_t last_sync_ms = 0, last_sync_off = 0;
+static volatile bool sync_pending = false;
+static sd_writer_stats_t stats;         // Escrita pela writer_task e pelo produtor: só via st_*
+
+// Contadores mexidos por mais de uma tarefa: cada campo é atualizado e
+// lido atomicamente (32 bits, sem trava)
+static void st_add(uint32_t *f, uint32_t v) { __atomic_add_fetch(f, v, __ATOMIC_RELAXED); }
+static void st_max(uint32_t *f, uint32_t v) {
+    uint32_t cur = __atomic_load_n(f, __ATOMIC_RELAXED);
+    while (v > cur && !__atomic_compare_exchange_n(f, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+static uint32_t st_get(const uint32_t *f) { return __atomic_load_n(f, __ATOMIC_RELAXED); }
+
+static bool wr_at(uint32_t off, const void *data, uint32_t len) {
+    if (lseek(wr_fd, off, SEEK_SET) < 0) return false;
+    return write(wr_fd, data, len) == (ssize_t)len;
+}
+
+static void wr_commit_len(uint32_t len) {
+    if (wr_len_field < 0) return;
+    uint8_t le[4] = { len, len >> 8, len >> 16, len >> 24 };
+    wr_at((uint32_t)wr_len_field, le, sizeof(le));
+    wr_committed = len;
+}
+
+// Trecho que cobre o campo de tamanho (o 1o bloco, com o cabeçalho) sai com o
+// valor já confirmado, e não com o zero do cabeçalho original: gravar o
+// trecho não pode desfazer um checkpoint. O produtor não volta ao campo.
+static void wr_patch_len(uint8_t *buf, uint32_t off, uint32_t len) {
+    if (wr_len_field < 0) return;
+    uint32_t f = (uint32_t)wr_len_field;
+    if (f < off || f + 4 > off + len) return;
+    uint8_t *p = buf + (f - off);
+    p[0] = wr_committed; p[1] = wr_committed >> 8; p[2] = wr_committed >> 16; p[3] = wr_committed >> 24;
+}
+
+static void writer_task(void *arg) {
+    wr_msg_t m;
+    while (1) {
+        if (xQueueReceive(full_q, &m, portMAX_DELAY) != pdTRUE) continue;
+        int64_t t0 = esp_timer_get_time();
+        if (m.cmd == WR_BLOCK) {
+            wr_patch_len(bufs[m.buf], m.off, m.len);
+            if (!wr_at(m.off, bufs[m.buf], m.len)) ESP_LOGE(TAG, "Falha no write de %lu bytes", m.len);
+            uint32_t ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+            st_max(&stats.max_write_ms, ms);
+            st_add(&stats.blocks, 1);
+            st_max(&stats.bytes, m.off + m.len);
+            __atomic_sub_fetch(&queued, m.len, __ATOMIC_RELEASE);
+            xQueueSend(free_q, &m.buf, portMAX_DELAY);
+        } else if (m.cmd == WR_SYNC) {
+            // O produtor só acrescenta depois de 'len': o trecho é estável
+            if (m.len) {
+                wr_patch_len(bufs[m.buf] + m.from, m.off, m.len);
+                wr_at(m.off, bufs[m.buf] + m.from, m.len);
+            }
+            wr_commit_len(m.off + m.len);
+            fsync(wr_fd);
+            uint32_t ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+            st_max(&stats.max_sync_ms, ms);
+            st_add(&stats.sync_total_ms, ms);
+            st_add(&stats.syncs, 1);
+            sync_pending = false;
+        } else if (m.cmd == WR_AUX) {
+            if (write(aux_fd, m.aux, m.len) != (ssize_t)m.len) ESP_LOGE(TAG, "Falha no arquivo de voltas");
+            fsync(aux_fd);
+            __atomic_sub_fetch(&aux_inflight, 1, __ATOMIC_RELEASE);
+        } else if (m.cmd == WR_JOB) {
+            m.job(m.aux);
+            __atomic_store_n(&job_inflight, false, __ATOMIC_RELEASE);
+        } else {
+            if (aux_fd >= 0) { close(aux_fd); aux_fd = -1; }
+            uint32_t bytes = st_get(&stats.bytes);
+            wr_commit_len(bytes);
+            if (wr_reserved && bytes < wr_reserved && ftruncate(wr_fd, bytes) != 0) {
+                ESP_LOGW(TAG, "Falha ao cortar o arquivo em %lu bytes", bytes);
+            }
+            close(wr_fd);
+            wr_fd = -1;
+            xSemaphoreGive(done_sem);
+        }
+    }
+}
+
+bool sd_writer_init(void) {
+    if (full_q) return true;
+    full_q = xQueueCreate(SD_LOG_BUF_COUNT + 3 + WR_AUX_SLOTS, sizeof(wr_msg_t));
+    free_q = xQueueCreate(SD_LOG_BUF_COUNT, sizeof(uint8_t));
+    done_sem = xSemaphoreCreateBinary();
+    for (uint8_t i = 0; i < SD_LOG_BUF_COUNT; i++) {
+        bufs[i] = heap_caps_malloc(SD_LOG_BUF_SIZE, MALLOC_CAP_SPIRAM);
+        if (!bufs[i]) { ESP_LOGE(TAG, "Sem PSRAM para o buffer %u", i); return false; }
+        xQueueSend(free_q, &i, 0);
+    }
+    xTaskCreate(writer_task, "sd_writer", 4096, NULL, SD_WRITER_PRIO, NULL);
+    return true;
+}
+
+// Entrega o buffer ativo à writer_task
+static void wr_submit(void) {
+    wr_msg_t m = { .cmd = WR_BLOCK, .buf = (uint8_t)active, .len = fill, .off = active_off };
+    __atomic_add_fetch(&queued, fill, __ATOMIC_RELEASE);
+    xQueueSend(full_q, &m, portMAX_DELAY); // Fila comporta todos os buffers: não espera
+    active_off += fill;
+    active = -1;
+    fill = 0;
+}
+
+static bool wr_acquire(void) {
+    uint8_t b;
+    if (xQueueReceive(free_q, &b, 0) != pdTRUE) return false;
+    active = b;
+    fill = 0;
+    return true;
+}
+
+// Checkpoint por tempo ou volume. Um por vez, e sem esperar a fila: se
+// não couber agora, tenta de novo no próximo registro. Só vai o que veio
+// depois do último checkpoint (a partir do setor onde ele parou); o que
+// ficou antes do buffer ativo já foi em blocos cheios.
+static void wr_maybe_sync(void) {
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t pos = active_off + fill;
+    if (sync_pending || pos == last_sync_off) return;
+    if (now - last_sync_ms < SD_SYNC_INTERVAL_MS && pos - last_sync_off < SD_SYNC_BYTES) return;
+    uint32_t from = last_sync_off & ~(uint32_t)(WR_SECTOR - 1);
+    if (from < active_off) from = active_off;
+    wr_msg_t m = { .cmd = WR_SYNC, .buf = (uint8_t)(active < 0 ? 0 : active), .off = from };
+    if (active >= 0) { m.from = from - active_off; m.len = pos - from; }
+    else m.off = pos;
+    sync_pending = true;
+    if (xQueueSend(full_q, &m, 0) != pdTRUE) { sync_pending = false; return; }
+    last_sync_ms = now;
+    last_sync_off = pos;
+}
+
+bool sd_writer_open(int fd, uint32_t reserved, int32_t len_field) {
+    if (is_open) sd_writer_close();
+    if (!full_q || fd < 0) return false;
+    wr_fd = fd;
+    wr_reserved = reserved;
+    wr_len_field = len_field;
+    wr_committed = 0;
+    active_off = 0;
+    last_sync_off = 0;
+    last_sync_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    stats = (sd_writer_stats_t){0};     // writer_task parada: o close anterior já voltou
+    is_open = true;
+    return true;
+}
+
+bool sd_writer_put(const void *data, size_t len) {
+    if (!is_open || len > SD_LOG_BUF_SIZE) return false;
+    // Registro nunca é gravado pela metade: se não couber e não houver
+    // buffer livre para o resto, descarta inteiro
+    if ((active < 0 && !wr_acquire()) || (len > SD_LOG_BUF_SIZE - fill && uxQueueMessagesWaiting(free_q) == 0)) {
+        st_add(&stats.dropped, 1);
+        st_add(&stats.dropped_bytes, (uint32_t)len);
+        return false;
+    }
+    const uint8_t *p = data;
+    size_t n = SD_LOG_BUF_SIZE - fill;
+    if (n > len) n = len;
+    memcpy(bufs[active] + fill, p, n);
+    fill += n;
+    if (fill == SD_LOG_BUF_SIZE) {
+        wr_submit();
+        if (len > n && wr_acquire()) {
+            memcpy(bufs[active], p + n, len - n);
+            fill = len - n;
+        }
+    }
+    uint32_t pending = __atomic_load_n(&queued, __ATOMIC_ACQUIRE) + fill;
+    st_max(&stats.hwm_bytes, pending);
+    wr_maybe_sync();
+    return true;
+}
+
+void sd_writer_close(void) {
+    if (!is_open) return;
+    if (active >= 0 && fill > 0) wr_submit(); // Último bloco, parcial
+    else if (active >= 0) { uint8_t b = (uint8_t)active; xQueueSend(free_q, &b, 0); active = -1; }
+    wr_msg_t m = { .cmd = WR_CLOSE };
+    xQueueSend(full_q, &m, portMAX_DELAY);
+    xSemaphoreTake(done_sem, portMAX_DELAY);
+    is_open = false;
+    sd_writer_stats_t st;
+    sd_writer_get_stats(&st);
+    ESP_LOGI(TAG, "Log fechado: %lu bytes em %lu blocos, pico %lu bytes pendentes, pior write %lu ms, %lu registros perdidos",
+             st.bytes, st.blocks, st.hwm_bytes, st.max_write_ms, st.dropped);
+    ESP_LOGI(TAG, "Checkpoints: %lu, pior %lu ms, total %lu ms", st.syncs, st.max_sync_ms, st.sync_total_ms);
+    if (st.aux_dropped) ESP_LOGW(TAG, "%lu linhas de voltas perdidas", st.aux_dropped);
+}
+
+bool sd_writer_open_aux(int fd) {
+    // Só entre o open e o close do log principal: a writer_task é quem fecha
+    if (!is_open || fd < 0) return false;
+    aux_fd = fd;
+    return true;
+}
+
+bool sd_writer_put_aux(const void *data, size_t len) {
+    if (!is_open || aux_fd < 0 || len > SD_AUX_LINE_MAX) return false;
+    // Limite próprio de vagas: as dos blocos ficam garantidas e o
+    // wr_submit nunca espera na fila
+    if (__atomic_load_n(&aux_inflight, __ATOMIC_ACQUIRE) >= WR_AUX_SLOTS) { st_add(&stats.aux_dropped, 1); return false; }
+    wr_msg_t m = { .cmd = WR_AUX, .len = (uint32_t)len };
+    memcpy(m.aux, data, len);
+    __atomic_add_fetch(&aux_inflight, 1, __ATOMIC_RELEASE);
+    if (xQueueSend(full_q, &m, 0) != pdTRUE) {
+        __atomic_sub_fetch(&aux_inflight, 1, __ATOMIC_RELEASE);
+        st_add(&stats.aux_dropped, 1);
+        return false;
+    }
+    return true;
+}
+
+bool sd_writer_job(void (*fn)(const void *arg), const void *arg, size_t len) {
+    if (!full_q || len > SD_AUX_LINE_MAX) return false;
+    bool idle = false;
+    if (!__atomic_compare_exchange_n(&job_inflight, &idle, true, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return false;
+    wr_msg_t m = { .cmd = WR_JOB, .job = fn };
+    memcpy(m.aux, arg, len);
+    if (xQueueSend(full_q, &m, 0) != pdTRUE) {
+        __atomic_store_n(&job_inflight, false, __ATOMIC_RELEASE);
+        return false;
+    }
+    return true;
+}
+
+void sd_writer_get_stats(sd_writer_stats_t *st) {
+    *st = (sd_writer_stats_t){
+        .dropped = st_get(&stats.dropped), .dropped_bytes = st_get(&stats.dropped_bytes),
+        .hwm_bytes = st_get(&stats.hwm_bytes), .max_write_ms = st_get(&stats.max_write_ms),
+        .blocks = st_get(&stats.blocks), .bytes = st_get(&stats.bytes),
+        .syncs = st_get(&stats.syncs), .max_sync_ms = st_get(&stats.max_sync_ms),
+        .sync_total_ms = st_get(&stats.sync_total_ms), .aux_dropped = st_get(&stats.aux_dropped),
+    };
+}
@@ -0,0 +1,59 @@
+#ifndef SD_WRITER_H
+#define SD_WRITER_H
+
+#define SD_AUX_LINE_MAX 160
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Gravador assíncrono do log da sessão. O produtor só copia bytes para o
+// buffer ativo (PSRAM); a writer_task grava blocos cheios, múltiplos do
+// setor, com write() direto no descritor. Uma parada do cartão atrasa a
+// gravação, mas nunca o laço do GPS.
+//
+// Durabilidade: a cada SD_SYNC_INTERVAL_MS ou SD_SYNC_BYTES o produtor
+// pede um checkpoint. A writer_task grava só o trecho do buffer ativo
+// que veio depois do checkpoint anterior (a partir do setor onde ele
+// parou; o bloco cheio é regravado por cima depois), atualiza o campo de
+// tamanho confirmado e faz fsync. Um corte
+// de energia perde no máximo o que veio depois do último checkpoint.
+// Blocos que cobrem o campo de tamanho saem com o último valor
+// confirmado: regravar o cabeçalho não volta o campo a zero.
+//
+// Estatísticas: a writer_task e quem grava atualizam campos diferentes;
+// cada campo é atômico, o conjunto não é um retrato de um só instante.
+typedef struct {
+    uint32_t dropped;        // Registros descartados (nenhum buffer livre)
+    uint32_t dropped_bytes;
+    uint32_t hwm_bytes;      // Maior volume aguardando gravação
+    uint32_t max_write_ms;   // Pior write() observado
+    uint32_t blocks;         // Blocos gravados
+    uint32_t bytes;          // Total gravado no arquivo
+    uint32_t syncs;          // Checkpoints (fsync) feitos
+    uint32_t max_sync_ms;    // Pior checkpoint (write parcial + fsync)
+    uint32_t sync_total_ms;  // Tempo total gasto em checkpoints
+    uint32_t aux_dropped;    // Linhas do arquivo auxiliar perdidas (fila cheia)
+} sd_writer_stats_t;
+
+bool sd_writer_init(void);
+// Assume o descritor até o close. Se o arquivo foi pré-alocado com
+// 'reserved' bytes, o close corta a sobra no tamanho realmente gravado.
+// 'len_field' é a posição no arquivo de um u32 LE que recebe os bytes
+// confirmados a cada checkpoint (-1 = sem campo).
+bool sd_writer_open(int fd, uint32_t reserved, int32_t len_field);
+bool sd_writer_put(const void *data, size_t len);
+void sd_writer_close(void);               // Grava o resto e fecha os dois arquivos (bloqueia)
+
+// Arquivo auxiliar da sessão (voltas): poucas linhas curtas, cada uma vai
+// inteira na fila e a writer_task grava e faz fsync na hora.
+bool sd_writer_open_aux(int fd);
+bool sd_writer_put_aux(const void *data, size_t len);
+void sd_writer_get_stats(sd_writer_stats_t *st);
+
+// Tarefa avulsa na writer_task (ex.: reescrever o banco de pistas no fim
+// da sessão), para o laço principal não esperar o cartão. 'arg' vai
+// copiado na mensagem; uma por vez (false = outra ainda na fila).
+bool sd_writer_job(void (*fn)(const void *arg), const void *arg, size_t len);
+
+#endif
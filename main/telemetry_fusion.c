@@ -0,0 +1,58 @@
+#include "telemetry_fusion.h"
+#include "telemetry_mpu.h"
+#include "gps_fusion.h"
+#include "config.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "FUSION";
+static gps_fusion_t fus;
+static mpu_reader_t imu_rd;
+static gps_data_t latest;
+static bool was_active = false;
+
+// Tudo aqui roda na tarefa principal: sem locks
+void fusion_init(void) {
+    gps_fusion_reset(&fus);
+    mpu_filtered_reader_init(&imu_rd);
+}
+
+void fusion_feed_fix(const gps_data_t *fix) {
+    if (!GPS_FUSION) return;
+    if (!mpu_is_calibrated()) {
+        // Eixos do kart ainda desconhecidos: o filtro recomeça do zero depois
+        if (fus.ready) gps_fusion_reset(&fus);
+        return;
+    }
+    // Relógio local em µs (mod 2^32), o mesmo da IMU
+    uint32_t t_meas_us = (uint32_t)(fix->timestamp_ms * 1000u) - GPS_FUSION_LATENCY_MS * 1000u;
+    gps_fusion_fix(&fus, fix, t_meas_us);
+}
+
+bool fusion_active(void) {
+    if (!GPS_FUSION || !fus.ready) return false;
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    // Sem fix, a IMU segue sozinha por até GPS_DR_MAX_MS (dead reckoning)
+    return (int32_t)(now_us - fus.last_fix_us) < GPS_DR_MAX_MS * 1000;
+}
+
+bool fusion_next(gps_data_t *out) {
+    mpu_filtered_t s;
+    // Mesmo inativo, o leitor anda: a amostra velha não serve depois
+    while (mpu_read_filtered(&imu_rd, &s)) {
+        gps_fusion_imu(&fus, s.t_us, s.d.ax, s.d.gz);
+        bool active = fusion_active();
+        if (active != was_active) {
+            ESP_LOGI(TAG, active ? "Fusão GPS+IMU ativa (100 Hz)" : "Fusão parada: seguindo só com o GPS");
+            was_active = active;
+        }
+        if (active && gps_fusion_output(&fus, out)) {
+            out->estimated = (int32_t)(s.t_us - fus.last_fix_us) > GPS_DR_EST_MS * 1000;
+            latest = *out;
+            return true;
+        }
+    }
+    return false;
+}
+
+gps_data_t fusion_get_latest(void) { return latest; }
@@ -0,0 +1,19 @@
+#ifndef TELEMETRY_FUSION_H
+#define TELEMETRY_FUSION_H
+
+#include <stdbool.h>
+#include "telemetry_gps.h"
+
+// Liga a fusão GPS + IMU ao laço principal. Com a IMU calibrada e fixes
+// recentes, cada amostra filtrada da IMU (100 Hz) vira um ponto no formato
+// de uma fix, que alimenta o cronômetro e o painel no lugar das fixes de
+// 10 Hz. Numa perda de sinal a IMU continua sozinha por até
+// GPS_DR_MAX_MS, com os pontos marcados como estimados. Fora disso, o
+// laço segue com as fixes puras.
+void fusion_init(void);
+void fusion_feed_fix(const gps_data_t *fix);   // Toda fix nova, uma vez
+bool fusion_next(gps_data_t *out);             // Próximo ponto fundido (false = nenhum)
+bool fusion_active(void);
+gps_data_t fusion_get_latest(void);
+
+#endif
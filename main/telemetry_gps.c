@@ -1,10 +1,21 @@
 #include "telemetry_gps.h"
 #include "config.h"
 #include "telemetry_sd.h"
+#include "gps_nmea.h"
+#include "gps_ubx.h"
+#include "track_geo.h"
+#include "lap_delta.h"
+#include "track_sectors.h"
+#include "track_db.h"
+#include "gps_fusion.h"
+#include "sd_writer.h"
+#include <stdio.h>
 #include <math.h>
-#include <string.h>
-#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "driver/uart.h"
 #include "esp_log.h"
 
@@ -12,131 +23,486 @@ static const char *TAG = "GPS_DRV";
 static gps_data_t last_gps = {0};
 static race_mode_t mode = MODE_CLASSIFICACAO;
 static finish_line_t f_line = {0};
-static uint64_t last_cross_us = 0;
+static uint64_t last_cross_us = 0;      // Relógio local (cronômetro da tela)
+static int64_t last_cross_gnss_us = 0;  // Relógio GNSS (tempo oficial da volta)
+static geo_gate_t gate;
+static geo_proj_t proj;                 // Plano local com origem na linha
+static gps_data_t prev_fix;
+static geo_point_t prev_pt;
+static bool has_prev = false;
 static uint32_t best_ms = 0, last_ms = 0;
 static uint16_t laps = 0;
-static bool inside = false;
-static char line_buffer[1024];
-static int line_pos = 0;
-static uint32_t last_uart_rx_ms = 0;
-static float speed_sum = 0;
+static gps_protocol_t proto = GPS_PROTO_NMEA;
+static nmea_parser_t nmea;
+static ubx_parser_t ubx;
+static volatile uint32_t last_uart_rx_ms = 0;
+static QueueHandle_t uart_queue = NULL;
+
+// Anel de fixes: um produtor (gps_task) e leitores independentes, cada um
+// com o seu cursor. Sem locks: o produtor escreve o slot e depois publica
+// o novo head; o leitor detecta se foi atropelado durante a cópia.
+static gps_data_t ring[GPS_RING_SIZE];
+static uint32_t ring_head = 0;
+static uint64_t speed_sum = 0; // mm/s acumulados na volta
 static uint32_t speed_samples = 0;
 
+// Volta de referência para o delta ao vivo. A volta atual é gravada em
+// trace_buf[trace_rec]; quando ela vira recorde, o buffer é entregue à
+// ref_task, que reamostra por distância no ref_buf livre e troca o
+// ponteiro ref_active. O caminho da fix nunca espera a reamostragem.
+static lap_trace_t trace_buf[2];
+static uint8_t trace_rec = 0;
+static lap_ref_t ref_buf[2];
+static lap_ref_t *ref_active = NULL;
+static lap_trace_t *ref_pending = NULL;
+static volatile bool ref_busy = false;
+static volatile uint32_t ref_gen = 0;   // Descarta reamostragem de sessão anterior
+static TaskHandle_t ref_task_handle = NULL;
+static float lap_dist_m = 0;
+static volatile int32_t live_delta_ms = 0;
+static volatile bool live_delta_ok = false;
+
+static sector_timer_t *sectors = NULL;  // Parciais (grade espacial na PSRAM)
+static uint32_t prev_t_ms = 0;          // Tempo de volta na fix anterior
+
 // Flag para disparar cronômetro apenas no movimento no modo RACE
 static bool race_waiting_for_movement = false;
 
-const uint8_t UBX_10HZ[] = {0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x64, 0x00, 0x01, 0x00, 0x01, 0x00, 0x7A, 0x12};
+// Pista reconhecida no banco: a linha foi armada longe dela, então o
+// cronômetro só começa na primeira passagem (a volta de saída não conta)
+static bool wait_first_cross = false;
+static bool line_from_db = false;
+static bool auto_arm_hold = false;      // Após encerrar, só rearma em movimento
+static uint32_t last_lookup_ms = 0;
+static bool track_saving = false;      // Banco sendo reescrito na writer_task
+
+// Dead reckoning sem IMU: a última posição medida e uma âncora de
+// DR_BASE_MS a 2*DR_BASE_MS antes dela (a taxa de curva sai da diferença
+// de rumo; base curta demais amplifica o ruído do rumo)
+#define DR_BASE_MS 200
+static gps_data_t dr_base[3];           // Âncora, candidata a âncora, última
+static uint8_t dr_n = 0;
+static bool last_cross_est = false;     // Largada da volta atual foi estimada
+
+static void gps_send(const uint8_t *frame, size_t len) {
+    uart_write_bytes(GPS_UART_NUM, (const char*)frame, len);
+    uart_wait_tx_done(GPS_UART_NUM, pdMS_TO_TICKS(100));
+}
+
+// Coloca o módulo em UBX puro com NAV-PVT a cada medida. Como o baud atual
+// do módulo é desconhecido, o CFG-PRT é repetido em cada baud candidato.
+static void gps_configure_ubx(void) {
+    static const uint32_t bauds[] = { 9600, 38400, 57600, 115200, 230400 };
+    uint8_t frame[32];
+    size_t n = ubx_cfg_prt_uart(GPS_BAUD_RATE, UBX_PROTO_UBX | UBX_PROTO_NMEA, UBX_PROTO_UBX, frame);
+    for (size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        uart_set_baudrate(GPS_UART_NUM, bauds[i]);
+        gps_send(frame, n);
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    uart_set_baudrate(GPS_UART_NUM, GPS_BAUD_RATE);
+    vTaskDelay(pdMS_TO_TICKS(100));
+
+    n = ubx_cfg_msg(UBX_CLASS_NAV, UBX_NAV_PVT, 1, frame);
+    gps_send(frame, n);
+    n = ubx_cfg_rate(1000 / GPS_RATE_HZ, frame);
+    gps_send(frame, n);
+    uart_flush_input(GPS_UART_NUM);
+    ESP_LOGI(TAG, "UBX NAV-PVT configurado (%d Hz)", GPS_RATE_HZ);
+}
+
+static int uart_source_read(void *ctx, uint8_t *buf, size_t len) {
+    int n = uart_read_bytes(GPS_UART_NUM, buf, len, 0);
+    if (n > 0) last_uart_rx_ms = esp_timer_get_time() / 1000;
+    return n;
+}
+
+static const gps_byte_source_t uart_source = { .read = uart_source_read, .ctx = NULL };
+
+static void gps_ring_push(const gps_data_t *d) {
+    uint32_t h = ring_head;
+    ring[h & (GPS_RING_SIZE - 1)] = *d;
+    __atomic_store_n(&ring_head, h + 1, __ATOMIC_RELEASE);
+}
+
+static bool gps_feed(uint8_t b) {
+    if (proto == GPS_PROTO_UBX) return ubx_parser_feed(&ubx, b, &last_gps);
+    return nmea_parser_feed(&nmea, b, &last_gps);
+}
+
+// Acorda só quando o driver da UART avisa que chegou dado: nenhum núcleo
+// fica em polling com o GPS parado, e cada fix é carimbada no instante em
+// que o checksum fecha, sem depender do laço do app_main.
+static void gps_task(void *arg) {
+    uart_event_t ev;
+    uint8_t buf[256];
+    while (1) {
+        if (xQueueReceive(uart_queue, &ev, portMAX_DELAY) != pdTRUE) continue;
+        switch (ev.type) {
+            case UART_DATA: {
+                int n;
+                while ((n = uart_source.read(uart_source.ctx, buf, sizeof(buf))) > 0) {
+                    for (int i = 0; i < n; i++) {
+                        if (gps_feed(buf[i])) {
+                            last_gps.timestamp_ms = esp_timer_get_time() / 1000;
+                            gps_ring_push(&last_gps);
+                        }
+                    }
+                }
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                ESP_LOGW(TAG, "Overflow na UART do GPS, descartando buffer");
+                uart_flush_input(GPS_UART_NUM);
+                xQueueReset(uart_queue);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void ref_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t gen = ref_gen;
+        lap_ref_t *spare = (ref_active == &ref_buf[0]) ? &ref_buf[1] : &ref_buf[0];
+        lap_ref_build(spare, ref_pending);
+        if (gen == ref_gen) __atomic_store_n(&ref_active, spare, __ATOMIC_RELEASE);
+        ref_busy = false;
+        ESP_LOGI(TAG, "Referência atualizada: %lu m", spare->n);
+    }
+}
+
+static void gps_ref_alloc(void) {
+    for (int i = 0; i < 2; i++) {
+        trace_buf[i].pts = heap_caps_malloc(LAP_TRACE_MAX_PTS * sizeof(lap_point_t), MALLOC_CAP_SPIRAM);
+        trace_buf[i].cap = trace_buf[i].pts ? LAP_TRACE_MAX_PTS : 0;
+        ref_buf[i].t_ms = heap_caps_malloc(LAP_REF_MAX_M * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+        ref_buf[i].cap = ref_buf[i].t_ms ? LAP_REF_MAX_M : 0;
+    }
+    if (!trace_buf[1].cap || !ref_buf[1].cap) ESP_LOGW(TAG, "Sem PSRAM para a volta de referência");
 
-void gps_init(void) {
+    sectors = heap_caps_malloc(sizeof(sector_timer_t), MALLOC_CAP_SPIRAM);
+    if (sectors) sector_init(sectors, SECTOR_AUTO_COUNT);
+    else ESP_LOGW(TAG, "Sem PSRAM para as parciais");
+}
+
+// Começa a gravar a trajetória de uma volta nova
+static void lap_trace_start(float dist_m, uint32_t t_ms) {
+    lap_trace_t *tr = &trace_buf[trace_rec];
+    lap_trace_reset(tr);
+    lap_trace_add(tr, 0, 0);
+    if (dist_m > 0) lap_trace_add(tr, dist_m, t_ms);
+    lap_dist_m = dist_m;
+}
+
+void gps_init(gps_protocol_t protocol) {
     const uart_config_t cfg = { .baud_rate = GPS_BAUD_RATE, .data_bits = UART_DATA_8_BITS, .parity = UART_PARITY_DISABLE, .stop_bits = UART_STOP_BITS_1, .source_clk = UART_SCLK_DEFAULT };
-    uart_driver_install(GPS_UART_NUM, 2048, 0, 0, NULL, 0);
+    uart_driver_install(GPS_UART_NUM, 2048, 0, 20, &uart_queue, 0);
     uart_param_config(GPS_UART_NUM, &cfg);
     uart_set_pin(GPS_UART_NUM, GPS_TX_PIN, GPS_RX_PIN, -1, -1);
-    uart_write_bytes(GPS_UART_NUM, (const char*)UBX_10HZ, sizeof(UBX_10HZ));
-}
-
-static void parse_nmea(const char *s) {
-    if (strstr(s, "GGA")) {
-        char *p = strdup(s), *tok, *save; int f = 0;
-        for (tok = strtok_r(p, ",", &save); tok; tok = strtok_r(NULL, ",", &save), f++) {
-            if (f == 2 && strlen(tok) > 0) { float raw = atof(tok); float deg = (int)(raw/100); last_gps.lat = deg + (raw-deg*100)/60.0f; }
-            else if (f == 3 && tok[0] == 'S') last_gps.lat *= -1;
-            else if (f == 4 && strlen(tok) > 0) { float raw = atof(tok); float deg = (int)(raw/100); last_gps.lon = deg + (raw-deg*100)/60.0f; }
-            else if (f == 5 && tok[0] == 'W') last_gps.lon *= -1;
-            else if (f == 6) last_gps.valid = (tok[0] != '0');
-            else if (f == 7) last_gps.sats = atoi(tok);
-        }
-        free(p);
-    } else if (strstr(s, "RMC")) {
-        char *p = strdup(s), *tok, *save; int f = 0;
-        for (tok = strtok_r(p, ",", &save); tok; tok = strtok_r(NULL, ",", &save), f++) {
-            if (f == 1 && strlen(tok) >= 6) {
-                int h = (tok[0]-'0')*10 + (tok[1]-'0');
-                h = (h < 3) ? h + 21 : h - 3; 
-                last_gps.hour = h;
-                last_gps.minute = (tok[2]-'0')*10 + (tok[3]-'0');
-                last_gps.second = (tok[4]-'0')*10 + (tok[5]-'0');
-            }
-            else if (f == 2) last_gps.valid = (tok[0] == 'A');
-            else if (f == 7 && strlen(tok) > 0) last_gps.speed_kmh = atof(tok) * 1.852f;
-            else if (f == 8 && strlen(tok) > 0) last_gps.course = atof(tok); 
-            else if (f == 9 && strlen(tok) >= 6) {
-                last_gps.day = (tok[0]-'0')*10 + (tok[1]-'0');
-                last_gps.month = (tok[2]-'0')*10 + (tok[3]-'0');
-                last_gps.year = (tok[4]-'0')*10 + (tok[5]-'0');
-            }
+
+    proto = protocol;
+    nmea_parser_init(&nmea);
+    ubx_parser_init(&ubx);
+
+    if (proto == GPS_PROTO_UBX) {
+        gps_configure_ubx();
+    } else {
+        uint8_t frame[16];
+        gps_send(frame, ubx_cfg_rate(1000 / GPS_RATE_HZ, frame));
+    }
+
+    gps_ref_alloc();
+    xTaskCreate(ref_task, "ref_task", 3072, NULL, 2, &ref_task_handle);
+    xTaskCreate(gps_task, "gps_task", 4096, NULL, GPS_TASK_PRIO, NULL);
+}
+
+void gps_reader_init(gps_reader_t *r) {
+    r->tail = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    r->dropped = 0;
+}
+
+bool gps_read_fix(gps_reader_t *r, gps_data_t *out) {
+    while (1) {
+        uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        if (r->tail == head) return false;
+        if (head - r->tail > GPS_RING_SIZE) {
+            // Leitor lento demais: pula para a fix mais antiga ainda no anel
+            r->dropped += head - r->tail - GPS_RING_SIZE;
+            r->tail = head - GPS_RING_SIZE;
         }
-        free(p);
+        *out = ring[r->tail & (GPS_RING_SIZE - 1)];
+        // Se o produtor chegou neste slot durante a cópia, tenta de novo.
+        // A barreira segura as leituras da cópia antes da releitura do head.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        if (head - r->tail < GPS_RING_SIZE) { r->tail++; return true; }
     }
 }
 
 gps_data_t gps_get_latest(void) {
-    uint8_t buf[512];
-    int len = uart_read_bytes(GPS_UART_NUM, buf, sizeof(buf)-1, pdMS_TO_TICKS(5));
-    if (len > 0) {
-        last_uart_rx_ms = esp_timer_get_time() / 1000;
-        for (int i = 0; i < len; i++) {
-            if (buf[i] == '\n') { line_buffer[line_pos] = '\0'; parse_nmea(line_buffer); line_pos = 0; }
-            else if (line_pos < 1023) line_buffer[line_pos++] = buf[i];
-        }
+    while (1) {
+        uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        if (head == 0) return (gps_data_t){0};
+        gps_data_t d = ring[(head - 1) & (GPS_RING_SIZE - 1)];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&ring_head, __ATOMIC_ACQUIRE) - head < GPS_RING_SIZE - 1) return d;
     }
-    last_gps.timestamp_ms = esp_timer_get_time() / 1000;
-    return last_gps;
 }
 
 bool gps_is_communicating(void) { return (esp_timer_get_time() / 1000 - last_uart_rx_ms) < 2000; }
 gps_status_t gps_get_status(void) {
     if (!gps_is_communicating()) return GPS_STATUS_DISCONNECTED;
-    if (last_gps.valid) return GPS_STATUS_FIXED;
-    return (last_gps.sats > 0) ? GPS_STATUS_SEARCHING : GPS_STATUS_OFF;
+    gps_data_t g = gps_get_latest();
+    if (g.valid) return GPS_STATUS_FIXED;
+    return (g.sats > 0) ? GPS_STATUS_SEARCHING : GPS_STATUS_OFF;
 }
 
-bool gps_set_finish_line(void) {
-    if (!last_gps.valid) return false;
-    f_line.lat = last_gps.lat; 
-    f_line.lon = last_gps.lon; 
-    f_line.heading = last_gps.course; 
+// Arma o cronômetro numa linha: plano local com origem nela, portão,
+// trajetória e parciais zeradas
+static void gps_arm_line(int32_t lat_e7, int32_t lon_e7, float heading) {
+    f_line.lat_e7 = lat_e7;
+    f_line.lon_e7 = lon_e7;
+    f_line.heading = heading;
     f_line.defined = true;
-    last_cross_us = esp_timer_get_time();
-    sd_start_new_session(last_gps); 
+    geo_proj_init(&proj, lat_e7, lon_e7);
+    geo_gate_init(&gate, (geo_point_t){0, 0}, heading, GATE_RADIUS_M);
+    has_prev = false;
+    lap_trace_start(0, 0);
+    prev_t_ms = 0;
+    if (sectors) sector_init(sectors, SECTOR_AUTO_COUNT);
+}
+
+bool gps_set_finish_line(void) {
+    gps_data_t g = gps_get_latest();
+    if (!g.valid) return false;
+    gps_arm_line(g.lat_e7, g.lon_e7, g.course_cd / 100.0f);
+    last_cross_us = (uint64_t)g.timestamp_ms * 1000;
+    last_cross_gnss_us = (int64_t)g.gnss_ms * 1000;
+    wait_first_cross = false;
+    line_from_db = false;
+    sd_start_new_session(g, NULL); 
+    return true;
+}
+
+bool gps_auto_arm(const gps_data_t *d, char *name, size_t len) {
+    if (f_line.defined || !d->valid) return false;
+    if (auto_arm_hold) {
+        if (d->speed_mms < GPS_KMH_TO_MMS(TRACK_ARM_KMH)) return false;
+        auto_arm_hold = false;
+    }
+    // A busca é O(1), mas toca o cartão quando há pista na célula
+    if (last_lookup_ms && d->timestamp_ms - last_lookup_ms < TRACK_LOOKUP_MS) return false;
+    if (__atomic_load_n(&track_saving, __ATOMIC_ACQUIRE)) return false;
+    last_lookup_ms = d->timestamp_ms;
+
+    track_t t;
+    if (!track_db_find(d->lat_e7, d->lon_e7, TRACK_MATCH_M, &t)) return false;
+    gps_arm_line(t.lat_e7, t.lon_e7, t.heading_cd / 100.0f);
+    for (uint8_t i = 0; sectors && i < t.n_splits; i++) {
+        geo_point_t c = { t.splits[i].x_cm / 100.0f, t.splits[i].y_cm / 100.0f };
+        sector_add_gate(sectors, c, t.splits[i].heading_cd / 100.0f, GATE_RADIUS_M);
+    }
+    last_cross_us = 0;
+    last_cross_gnss_us = 0;
+    wait_first_cross = true;
+    line_from_db = true;
+    sd_start_new_session(*d, t.name);
+    if (name) snprintf(name, len, "%s", t.name);
+    ESP_LOGI(TAG, "Pista reconhecida: %s (%u parciais)", t.name, t.n_splits);
+    return true;
+}
+
+// Roda na writer_task: a reescrita do banco não trava o laço principal
+static void track_save_job(const void *arg) {
+    track_t t = *(const track_t *)arg;
+    track_t old;
+    // Linha marcada em cima de uma pista já gravada: não duplica
+    if (track_db_find(t.lat_e7, t.lon_e7, GATE_RADIUS_M * 4, &old)) {
+        __atomic_store_n(&track_saving, false, __ATOMIC_RELEASE);
+        return;
+    }
+    snprintf(t.name, sizeof(t.name), "PISTA %03lu", (unsigned long)track_db_count() + 1);
+    bool ok = track_db_add(&t);
+    ESP_LOGI(TAG, "%s %s no banco de pistas", ok ? "Gravada" : "Falha ao gravar", t.name);
+    __atomic_store_n(&track_saving, false, __ATOMIC_RELEASE);
+}
+
+_Static_assert(sizeof(track_t) <= SD_AUX_LINE_MAX, "track_t não cabe na mensagem da writer_task");
+
+bool gps_save_track(void) {
+    if (!f_line.defined || line_from_db || laps == 0) return false;
+    track_t t = {0};
+    t.lat_e7 = f_line.lat_e7;
+    t.lon_e7 = f_line.lon_e7;
+    t.heading_cd = (uint16_t)((uint32_t)lroundf(f_line.heading * 100.0f) % 36000);
+    geo_point_t c;
+    float h;
+    for (uint8_t i = 0; sectors && i < TRACK_MAX_SPLITS && sector_get_gate(sectors, i, &c, &h); i++) {
+        t.splits[i] = (track_split_t){ (int32_t)lroundf(c.x * 100.0f), (int32_t)lroundf(c.y * 100.0f),
+                                       (uint16_t)((uint32_t)lroundf(h * 100.0f) % 36000) };
+        t.n_splits = i + 1;
+    }
+    // As buscas do auto-arm param até o job terminar (o banco é trocado no meio)
+    __atomic_store_n(&track_saving, true, __ATOMIC_RELEASE);
+    if (!sd_writer_job(track_save_job, &t, sizeof(t))) {
+        __atomic_store_n(&track_saving, false, __ATOMIC_RELEASE);
+        ESP_LOGW(TAG, "Pista não gravada: writer ocupado");
+        return false;
+    }
+    return true;
+}
+
+static void dr_note(const gps_data_t *d) {
+    if (d->estimated) return;
+    if (dr_n == 0) { dr_base[1] = *d; dr_n = 1; }
+    else if (d->timestamp_ms - dr_base[1].timestamp_ms >= DR_BASE_MS) {
+        dr_base[0] = dr_base[1];
+        dr_base[1] = *d;
+        dr_n = 2;
+    }
+    dr_base[2] = *d;
+}
+
+// Fix sem posição: extrapola da última medida, por até GPS_DR_MAX_MS
+static bool dr_estimate(const gps_data_t *d, gps_data_t *out) {
+    if (dr_n < 2) return false;
+    uint32_t dt = d->timestamp_ms - dr_base[2].timestamp_ms;
+    if (dt > GPS_DR_MAX_MS) return false;
+    gps_dr_ctrv(&dr_base[0], &dr_base[2], dt, out);
+    out->sats = d->sats;
     return true;
 }
 
 void gps_process_timing(gps_data_t *d) {
-    if (!d->valid || !f_line.defined) return;
+    gps_data_t est;
+    if (d->valid) dr_note(d);
+    else if (f_line.defined && has_prev && dr_estimate(d, &est)) d = &est;
+    if (!d->valid || !f_line.defined) { has_prev = false; return; }
 
     // Se estivermos esperando o movimento para largada no modo RACE
     if (mode == MODE_CORRIDA && race_waiting_for_movement) {
-        if (d->speed_kmh > 5.0f) {
-            last_cross_us = esp_timer_get_time();
+        if (d->speed_mms > GPS_KMH_TO_MMS(5)) {
+            last_cross_us = (uint64_t)d->timestamp_ms * 1000;
+            last_cross_gnss_us = (int64_t)d->gnss_ms * 1000;
+            last_cross_est = d->estimated;
+            lap_trace_start(0, 0);
+            prev_t_ms = 0;
             race_waiting_for_movement = false;
             ESP_LOGI(TAG, "Largada detectada! Cronômetro iniciado.");
         }
+        has_prev = false;
         return; 
     }
 
-    if (d->speed_kmh > 1.0) { speed_sum += d->speed_kmh; speed_samples++; }
+    if (d->speed_mms > GPS_KMH_TO_MMS(1)) { speed_sum += (uint32_t)d->speed_mms; speed_samples++; }
+
+    geo_point_t pt = geo_project(&proj, d->lat_e7, d->lon_e7);
+    float seg = 0, frac;
+    if (has_prev) {
+        float dx = pt.x - prev_pt.x, dy = pt.y - prev_pt.y;
+        seg = sqrtf(dx * dx + dy * dy);
+    }
+    int64_t day_us = (int64_t)GNSS_DAY_MS * 1000;
+    uint32_t t_ms = (uint32_t)((((int64_t)d->gnss_ms * 1000 - last_cross_gnss_us + day_us) % day_us) / 1000);
+    bool lap_closed = false;
+
+    if (wait_first_cross) {
+        // Linha do banco: a primeira passagem só dá a largada
+        if (has_prev && geo_gate_cross(&gate, prev_pt, pt, &frac)) {
+            uint32_t step_ms = (d->gnss_ms + GNSS_DAY_MS - prev_fix.gnss_ms) % GNSS_DAY_MS;
+            last_cross_gnss_us = (int64_t)prev_fix.gnss_ms * 1000 + (int64_t)(frac * step_ms * 1000.0f);
+            int64_t after_us = ((int64_t)d->gnss_ms * 1000 - last_cross_gnss_us + day_us) % day_us;
+            last_cross_us = (uint64_t)d->timestamp_ms * 1000 - (uint64_t)after_us;
+            lap_trace_start((1.0f - frac) * seg, (uint32_t)(after_us / 1000));
+            prev_t_ms = (uint32_t)(after_us / 1000);
+            speed_sum = 0; speed_samples = 0;
+            last_cross_est = d->estimated || prev_fix.estimated;
+            wait_first_cross = false;
+            ESP_LOGI(TAG, "Primeira passagem pela linha, cronômetro iniciado.");
+        }
+        prev_fix = *d;
+        prev_pt = pt;
+        has_prev = true;
+        return;
+    }
+
+    if (has_prev && sectors) sector_process(sectors, prev_pt, pt, prev_t_ms, t_ms);
+
+    if (has_prev && geo_gate_cross(&gate, prev_pt, pt, &frac)) {
+        // Interpola o instante do cruzamento entre as duas medidas GNSS
+        uint32_t step_ms = (d->gnss_ms + GNSS_DAY_MS - prev_fix.gnss_ms) % GNSS_DAY_MS;
+        int64_t cross_gnss_us = (int64_t)prev_fix.gnss_ms * 1000 + (int64_t)(frac * step_ms * 1000.0f);
+        int64_t lap_us = (cross_gnss_us - last_cross_gnss_us + day_us) % day_us;
+        uint32_t diff = (uint32_t)((lap_us + 500) / 1000);
 
-    float dist = sqrtf(powf(111320.0f*(d->lat-f_line.lat),2)+powf(111320.0f*cosf(d->lat*0.0174f)*(d->lon-f_line.lon),2));
-    float diff_heading = fabsf(d->course - f_line.heading);
-    if (diff_heading > 180) diff_heading = 360 - diff_heading;
+        if (diff > MIN_LAP_TIME_MS) {
+            // Qualquer ponta da volta cruzada por posição estimada: tempo estimado
+            bool cross_est = d->estimated || prev_fix.estimated;
+            bool lap_est = cross_est || last_cross_est;
+            last_cross_est = cross_est;
+            if (lap_est) ESP_LOGW(TAG, "Volta %u cronometrada com posição estimada (sem sinal GNSS)", laps + 1);
+            bool is_best = (best_ms == 0 || diff < best_ms);
+            float lap_dist = lap_dist_m + frac * seg;
+            last_ms = diff; laps++;
+            if (is_best) best_ms = diff;
 
-    if (dist < GATE_RADIUS_M && diff_heading < 45.0f) {
-        if (!inside) {
-            uint64_t now = esp_timer_get_time();
-            uint32_t diff = (uint32_t)((now - last_cross_us) / 1000);
-            if (diff > MIN_LAP_TIME_MS) {
-                last_ms = diff; laps++;
-                if (best_ms == 0 || diff < best_ms) best_ms = diff;
-                float avg_speed = (speed_samples > 0) ? (speed_sum / speed_samples) : d->speed_kmh;
-                sd_save_lap_event(laps, diff, avg_speed, *d, mode);
-                speed_sum = 0; speed_samples = 0; last_cross_us = now;
+            uint32_t sec_ms[SECTOR_MAX];
+            uint8_t n_sec = sectors ? sector_close_lap(sectors, diff, lap_dist, GATE_RADIUS_M, sec_ms) : 0;
+
+            uint32_t avg_mms = (speed_samples > 0) ? (uint32_t)(speed_sum / speed_samples) : (uint32_t)d->speed_mms;
+            float avg_speed = avg_mms * 0.0036f; // km/h, só uma vez por volta
+            sd_save_lap_event(laps, diff, avg_speed, *d, mode, sec_ms, n_sec, lap_est);
+            speed_sum = 0; speed_samples = 0;
+            last_cross_gnss_us = cross_gnss_us;
+            // Cronômetro local recua o que a fix atual já andou depois da linha
+            int64_t after_us = ((int64_t)d->gnss_ms * 1000 - cross_gnss_us + day_us) % day_us;
+            last_cross_us = (uint64_t)d->timestamp_ms * 1000 - (uint64_t)after_us;
+
+            // Fecha a trajetória exatamente na linha; recorde vira referência
+            lap_trace_add(&trace_buf[trace_rec], lap_dist, diff);
+            if (is_best && !ref_busy && ref_task_handle) {
+                ref_pending = &trace_buf[trace_rec];
+                ref_busy = true;
+                trace_rec ^= 1;
+                xTaskNotifyGive(ref_task_handle);
             }
-            inside = true;
+            t_ms = (uint32_t)(after_us / 1000);
+            lap_trace_start((1.0f - frac) * seg, t_ms);
+            lap_closed = true;
         }
-    } else inside = false;
+    }
+
+    if (!lap_closed) {
+        lap_dist_m += seg;
+        lap_trace_add(&trace_buf[trace_rec], lap_dist_m, t_ms);
+        if (sectors) sector_auto_sample(sectors, pt, d->course_cd / 100.0f, lap_dist_m);
+
+        // Delta real: tempo atual contra o tempo da referência na mesma distância
+        uint32_t ref_ms;
+        lap_ref_t *ref = __atomic_load_n(&ref_active, __ATOMIC_ACQUIRE);
+        live_delta_ok = ref && lap_ref_lookup(ref, lap_dist_m, &ref_ms);
+        if (live_delta_ok) live_delta_ms = (int32_t)t_ms - (int32_t)ref_ms;
+    }
+
+    prev_fix = *d;
+    prev_pt = pt;
+    prev_t_ms = t_ms;
+    has_prev = true;
 }
 
+bool gps_add_split_gate(void) {
+    gps_data_t g = gps_get_latest();
+    if (!g.valid || !f_line.defined || !sectors) return false;
+    geo_point_t c = geo_project(&proj, g.lat_e7, g.lon_e7);
+    return sector_add_gate(sectors, c, g.course_cd / 100.0f, GATE_RADIUS_M);
+}
+
+uint32_t gps_get_theoretical_best(void) { return sectors ? sector_theoretical_best(sectors) : 0; }
+
 uint32_t gps_get_current_time_ms(void) { 
     if (last_cross_us == 0) return 0;
     return (uint32_t)((esp_timer_get_time() - last_cross_us)/1000); 
@@ -153,7 +519,18 @@ void gps_reset_session(void) {
     speed_sum = 0; 
     speed_samples = 0; 
     last_cross_us = 0;
+    last_cross_gnss_us = 0;
+    has_prev = false;
+    dr_n = 0;
+    last_cross_est = false;
+    ref_gen++;
+    __atomic_store_n(&ref_active, NULL, __ATOMIC_RELEASE);
+    live_delta_ok = false;
+    lap_dist_m = 0;
     f_line.defined = false;
+    wait_first_cross = false;
+    line_from_db = false;
+    auto_arm_hold = true;
     mode = MODE_CLASSIFICACAO; 
     race_waiting_for_movement = false;
     ESP_LOGI(TAG, "Sessão encerrada e resetada.");
@@ -173,6 +550,8 @@ void gps_toggle_mode(void) {
 
 int32_t gps_get_live_delta(void) {
     if (best_ms == 0 || last_cross_us == 0) return 0;
+    if (live_delta_ok) return live_delta_ms;
+    // Sem referência para esta distância: cai para o tempo corrido - best
     uint32_t current_lap_time = (esp_timer_get_time() - last_cross_us) / 1000;
     return (int32_t)current_lap_time - (int32_t)best_ms;
 }
\ No newline at end of file
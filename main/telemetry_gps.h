@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef enum { 
     GPS_STATUS_DISCONNECTED, 
@@ -11,28 +12,56 @@ typedef enum {
     GPS_STATUS_FIXED         
 } gps_status_t;
 
+#define GPS_KMH_TO_MMS(k)   ((int32_t)(k) * 10000 / 36)
+#define GNSS_DAY_MS         86400000u // gnss_ms volta a zero à meia-noite
+
+typedef enum { GPS_PROTO_NMEA, GPS_PROTO_UBX } gps_protocol_t;
+
 typedef enum { MODE_CLASSIFICACAO, MODE_CORRIDA } race_mode_t;
 
+// Coordenadas em 1e-7 grau e velocidade em mm/s: a precisão nativa do
+// receptor, sem ponto flutuante entre o parser, o cronômetro e o log.
 typedef struct {
-    float lat; float lon; float speed_kmh; uint32_t timestamp_ms;
-    float course; // Direção atual em graus (0-359)
+    int32_t lat_e7; int32_t lon_e7; int32_t speed_mms; uint32_t timestamp_ms;
+    uint32_t gnss_ms; // Hora da medida no relógio do GNSS (ms do dia)
+    uint16_t course_cd; // Direção atual em centésimos de grau (0-35999)
     int sats; 
     bool valid;
+    bool estimated;   // Posição extrapolada (sem fix nova): dead reckoning
     uint8_t day, month, year;
     uint8_t hour, minute, second;
 } gps_data_t;
 
 typedef struct { 
-    float lat; 
-    float lon; 
+    int32_t lat_e7; 
+    int32_t lon_e7; 
     float heading; // Direção da linha de chegada
-    bool defined; 
+    bool defined;
 } finish_line_t;
 
-void gps_init(void);
+// Fonte de bytes genérica: UART no firmware, arquivo gravado no host.
+// read() retorna quantos bytes copiou (0 = nada no momento, <0 = erro).
+typedef struct {
+    int (*read)(void *ctx, uint8_t *buf, size_t len);
+    void *ctx;
+} gps_byte_source_t;
+
+// Cursor de leitura do anel de fixes (cada consumidor tem o seu)
+typedef struct {
+    uint32_t tail;
+    uint32_t dropped; // Fixes perdidas por o leitor ter ficado para trás
+} gps_reader_t;
+
+void gps_init(gps_protocol_t protocol);
+void gps_reader_init(gps_reader_t *r);
+bool gps_read_fix(gps_reader_t *r, gps_data_t *out);
 gps_data_t gps_get_latest(void);
 void gps_process_timing(gps_data_t *data);
 bool gps_set_finish_line(void);
+// Procura a pista no banco do SD e, se achar, arma linha e parciais e abre
+// a sessão. Retorna true só na fix que armou ('name' recebe a pista).
+bool gps_auto_arm(const gps_data_t *d, char *name, size_t len);
+bool gps_save_track(void);               // Grava a linha manual como pista nova
 void gps_toggle_mode(void);
 race_mode_t gps_get_mode(void);
 gps_status_t gps_get_status(void);
@@ -43,5 +72,9 @@ uint32_t gps_get_best_lap(void);
 uint16_t gps_get_lap_count(void);
 void gps_reset_session(void);
 int32_t gps_get_live_delta(void);
+bool gps_add_split_gate(void);           // Parcial manual na posição atual
+uint32_t gps_get_theoretical_best(void); // Soma dos melhores setores (0 = incompleto)
+
+static inline int32_t gps_speed_kmh(const gps_data_t *d) { return d->speed_mms * 36 / 10000; }
 
 #endif
\ No newline at end of file
@@ -1,31 +1,352 @@
 #include "telemetry_mpu.h"
+#include "mpu6050.h"
+#include "imu_filter.h"
+#include "imu_orient.h"
 #include "config.h"
 #include "driver/i2c_master.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
 #include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
 #include <math.h>
+#include <string.h>
 
 static const char *TAG = "MPU6050";
-static mpu_data_t current_mpu = {0};
 static i2c_master_dev_handle_t dev_handle = NULL;
+static TaskHandle_t mpu_task_handle = NULL;
+static float accel_lsb = 16384.0f, gyro_lsb = 131.0f;
+static mpu_stats_t stats;
 
-void mpu_init(void) {
+// Anel de amostras: mesmo modelo do anel de fixes do GPS (um produtor, a
+// mpu_task; leitores com cursor próprio, sem locks)
+static mpu_sample_t ring[MPU_RING_SIZE];
+static uint32_t ring_head = 0;
+static mpu_filtered_t out_ring[IMU_OUT_RING_SIZE];
+static uint32_t out_head = 0;
+static imu_filter_t filt;
+static uint32_t filt_delay_us;
+static bool imu_ok = false;
+
+// Montagem em uso: duas cópias, a tarefa principal escreve na que não está
+// valendo e troca o índice; a mpu_task lê o índice uma vez por rajada
+static imu_orient_t orient[2];
+static uint8_t orient_cur = 0;
+
+// Calibração: só a tarefa principal mexe (mpu_calib_feed)
+static mpu_reader_t cal_rd;
+static imu_calib_t cal;         // Acumulado até fechar a calibração
+static imu_calib_t still_win;   // Janela parada em curso
+static bool cal_done = false;
+static uint16_t still_run = 0;
+static int32_t prev_mms = -1;
+static uint32_t prev_ms = 0;
+
+// Data-ready: a ISR só conta e guarda o instante; acorda a tarefa a cada
+// MPU_DRAIN_SAMPLES amostras, para o FIFO sair em rajadas e não uma por vez
+static volatile uint32_t irq_count = 0;
+static uint32_t irq_last_us = 0;      // 32 bits: escrita/leitura atômica no núcleo de 32 bits
+
+// --- Barramento I2C ---
+static int i2c_bus_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len) {
+    uint8_t buf[8];
+    if (len + 1 > sizeof(buf)) return -1;
+    buf[0] = reg;
+    memcpy(buf + 1, data, len);
+    return i2c_master_transmit(dev_handle, buf, len + 1, 20) == ESP_OK ? 0 : -1;
+}
+
+static int i2c_bus_read(void *ctx, uint8_t reg, uint8_t *data, size_t len) {
+    return i2c_master_transmit_receive(dev_handle, &reg, 1, data, len, 20) == ESP_OK ? 0 : -1;
+}
+
+static const mpu_bus_t i2c_bus = { .write = i2c_bus_write, .read = i2c_bus_read, .ctx = NULL };
+
+static void IRAM_ATTR mpu_isr(void *arg) {
+    __atomic_store_n(&irq_last_us, (uint32_t)esp_timer_get_time(), __ATOMIC_RELEASE);
+    if (++irq_count % MPU_DRAIN_SAMPLES) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(mpu_task_handle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// Converte e publica a saída do filtro; o instante é o da amostra de origem
+// recuado do atraso de grupo do filtro
+static void mpu_publish_filtered(const imu_filter_out_t *o, int n, uint32_t t_first, uint32_t period_us) {
+    for (int i = 0; i < n; i++) {
+        uint32_t h = out_head;
+        mpu_filtered_t *s = &out_ring[h & (IMU_OUT_RING_SIZE - 1)];
+        s->t_us = t_first + o[i].src * period_us;
+        s->d = (mpu_data_t){
+            .ax = o[i].acc[0] / accel_lsb, .ay = o[i].acc[1] / accel_lsb, .az = o[i].acc[2] / accel_lsb,
+            .gx = o[i].gyro[0] / gyro_lsb, .gy = o[i].gyro[1] / gyro_lsb, .gz = o[i].gyro[2] / gyro_lsb,
+        };
+        __atomic_store_n(&out_head, h + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void mpu_task(void *arg) {
+    static mpu_raw_t raw[MPU_FIFO_SIZE / MPU_FIFO_FRAME];
+    static imu_filter_out_t fout[MPU_FIFO_SIZE / MPU_FIFO_FRAME / IMU_DECIM + 1];
+    const uint32_t period_us = 1000000 / MPU_SAMPLE_HZ;
+    // Sem o fio do INT, ou se ele parar, drena por tempo
+    const TickType_t wait = pdMS_TO_TICKS(MPU_DRAIN_SAMPLES * 1000 / MPU_SAMPLE_HZ + 5);
+    while (1) {
+        if (MPU_INT_PIN >= 0) ulTaskNotifyTake(pdTRUE, wait);
+        else vTaskDelay(wait);
+        uint32_t t_read = (uint32_t)esp_timer_get_time();
+        int n = mpu6050_fifo_read(&i2c_bus, raw, sizeof(raw) / sizeof(raw[0]), MPU_FIFO_BURST);
+        if (n == -1) { stats.bus_errors++; continue; }
+        if (n == -2) { stats.overflows++; ESP_LOGW(TAG, "FIFO do MPU transbordou"); continue; }
+        stats.bursts += (n + MPU_FIFO_BURST / MPU_FIFO_FRAME - 1) / (MPU_FIFO_BURST / MPU_FIFO_FRAME);
+
+        // A amostra mais nova é a do último data-ready (ou da leitura, sem
+        // INT); as anteriores vêm em passos do período
+        uint32_t t0 = mpu6050_burst_t0(__atomic_load_n(&irq_last_us, __ATOMIC_ACQUIRE), t_read,
+                                       period_us, MPU_INT_PIN >= 0, n);
+        const imu_orient_t *o = &orient[__atomic_load_n(&orient_cur, __ATOMIC_ACQUIRE)];
+        for (int i = 0; i < n; i++) {
+            uint32_t h = ring_head;
+            mpu_sample_t *s = &ring[h & (MPU_RING_SIZE - 1)];
+            s->t_us = t0 + (uint32_t)i * period_us;
+            memcpy(s->acc, raw[i].acc, sizeof(s->acc));
+            memcpy(s->gyro, raw[i].gyro, sizeof(s->gyro));
+            __atomic_store_n(&ring_head, h + 1, __ATOMIC_RELEASE);
+            imu_orient_apply(o, &raw[i]);   // O anel bruto fica nos eixos do sensor
+        }
+        stats.samples += n;
+
+        int64_t t_run = esp_timer_get_time();
+        int m = imu_filter_run(&filt, raw, n, fout);
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t_run);
+        stats.filter_us += us;
+        if (us > stats.filter_max_us) stats.filter_max_us = us;
+        mpu_publish_filtered(fout, m, t0 - filt_delay_us, period_us);
+        if (stats.samples >= 10000 && stats.samples - n < 10000) {
+            ESP_LOGI(TAG, "Filtro: %lu ns por amostra, pior rajada %lu us",
+                     (unsigned long)((uint64_t)stats.filter_us * 1000 / stats.samples), stats.filter_max_us);
+        }
+    }
+}
+
+// --- Montagem (NVS) ---
+static void orient_publish(const imu_orient_t *o) {
+    uint8_t next = orient_cur ^ 1;
+    orient[next] = *o;
+    __atomic_store_n(&orient_cur, next, __ATOMIC_RELEASE);
+}
+
+static bool orient_load(imu_orient_t *o) {
+    nvs_handle_t h;
+    if (nvs_open("kartbox", NVS_READONLY, &h) != ESP_OK) return false;
+    size_t len = sizeof(*o);
+    bool ok = nvs_get_blob(h, "imu_orient", o, &len) == ESP_OK && len == sizeof(*o) && o->magic == IMU_ORIENT_MAGIC;
+    nvs_close(h);
+    return ok;
+}
+
+static void orient_save(const imu_orient_t *o) {
+    nvs_handle_t h;
+    if (nvs_open("kartbox", NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_set_blob(h, "imu_orient", o, sizeof(*o)) != ESP_OK || nvs_commit(h) != ESP_OK) {
+        ESP_LOGW(TAG, "Falha ao gravar a calibração no NVS");
+    }
+    nvs_close(h);
+}
+
+bool mpu_init(void) {
     i2c_master_bus_config_t bus_cfg = {
         .i2c_port = MPU_I2C_NUM,
         .sda_io_num = MPU_SDA_PIN,
         .scl_io_num = MPU_SCL_PIN,
         .clk_source = I2C_CLK_SRC_DEFAULT,
+        .flags.enable_internal_pullup = true,
     };
     i2c_master_bus_handle_t bus_handle;
-    if (i2c_new_master_bus(&bus_cfg, &bus_handle) != ESP_OK) return;
+    if (i2c_new_master_bus(&bus_cfg, &bus_handle) != ESP_OK) return false;
 
     i2c_device_config_t dev_cfg = {
         .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address = 0x68,
+        .device_address = MPU6050_ADDR,
         .scl_speed_hz = MPU_I2C_FREQ,
     };
-    i2c_master_bus_add_device(bus_handle, &dev_cfg, &dev_handle);
-    ESP_LOGI(TAG, "MPU driver initialized (but not active in main)");
+    if (i2c_master_bus_add_device(bus_handle, &dev_cfg, &dev_handle) != ESP_OK) return false;
+
+    const mpu_config_t cfg = {
+        .sample_hz = MPU_SAMPLE_HZ, .dlpf_cfg = MPU_DLPF_CFG,
+        .accel_fs = MPU_ACCEL_FS, .gyro_fs = MPU_GYRO_FS,
+        .int_data_ready = MPU_INT_PIN >= 0,
+    };
+    if (!mpu6050_configure(&i2c_bus, &cfg)) {
+        ESP_LOGW(TAG, "MPU-6050 não respondeu, seguindo sem IMU");
+        return false;
+    }
+    accel_lsb = mpu6050_accel_lsb(MPU_ACCEL_FS);
+    gyro_lsb = mpu6050_gyro_lsb(MPU_GYRO_FS);
+    imu_filter_init(&filt, MPU_SAMPLE_HZ, IMU_LPF_HZ, IMU_LPF_ORDER, IMU_DECIM);
+    filt_delay_us = (uint32_t)(imu_filter_delay(&filt) * 1000000.0f / MPU_SAMPLE_HZ);
+
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        nvs_flash_erase();
+        nvs_flash_init();
+    }
+    imu_orient_t o;
+    cal_done = orient_load(&o);
+    if (!cal_done) imu_orient_identity(&o);
+    orient[0] = orient[1] = o;
+    ESP_LOGI(TAG, cal_done ? "Montagem carregada do NVS" : "Montagem sem calibração: eixos do sensor até calibrar");
+
+    xTaskCreate(mpu_task, "mpu_task", 4096, NULL, MPU_TASK_PRIO, &mpu_task_handle);
+    int int_pin = MPU_INT_PIN;
+    if (int_pin >= 0) {
+        // Pull-down: placa sem o fio não fica com o pino flutuando
+        gpio_config_t io = { .pin_bit_mask = 1ULL << int_pin, .mode = GPIO_MODE_INPUT,
+                             .pull_down_en = 1, .intr_type = GPIO_INTR_POSEDGE };
+        gpio_config(&io);
+        gpio_install_isr_service(0);    // Já instalado por outro driver: segue
+        gpio_isr_handler_add((gpio_num_t)int_pin, mpu_isr, NULL);
+    }
+    mpu_reader_init(&cal_rd);
+    imu_ok = true;
+    ESP_LOGI(TAG, "MPU-6050 a %d Hz, DLPF %d, FIFO em rajadas de %d bytes", MPU_SAMPLE_HZ, MPU_DLPF_CFG, MPU_FIFO_BURST);
+    if (int_pin >= 0) ESP_LOGI(TAG, "FIFO drenado pelo data-ready no GPIO%d", int_pin);
+    else ESP_LOGI(TAG, "FIFO drenado por tempo a cada %d ms (sem fio do INT)", MPU_DRAIN_SAMPLES * 1000 / MPU_SAMPLE_HZ);
+    return true;
+}
+
+// Leitura sem lock de um dos anéis: copia e confere se o produtor não
+// passou por cima da posição enquanto isso
+static bool ring_read(const void *ring, size_t elem, uint32_t size, const uint32_t *head_p, mpu_reader_t *r, void *out) {
+    while (1) {
+        uint32_t head = __atomic_load_n(head_p, __ATOMIC_ACQUIRE);
+        if (r->tail == head) return false;
+        if (head - r->tail > size) {
+            r->dropped += head - r->tail - size;
+            r->tail = head - size;
+        }
+        memcpy(out, (const uint8_t *)ring + (r->tail & (size - 1)) * elem, elem);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // Cópia fica antes da releitura do head
+        head = __atomic_load_n(head_p, __ATOMIC_ACQUIRE);
+        if (head - r->tail < size) { r->tail++; return true; }
+    }
+}
+
+void mpu_reader_init(mpu_reader_t *r) {
+    r->tail = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    r->dropped = 0;
+}
+
+void mpu_filtered_reader_init(mpu_reader_t *r) {
+    r->tail = __atomic_load_n(&out_head, __ATOMIC_ACQUIRE);
+    r->dropped = 0;
+}
+
+bool mpu_read_sample(mpu_reader_t *r, mpu_sample_t *out) {
+    return ring_read(ring, sizeof(ring[0]), MPU_RING_SIZE, &ring_head, r, out);
+}
+
+bool mpu_read_filtered(mpu_reader_t *r, mpu_filtered_t *out) {
+    return ring_read(out_ring, sizeof(out_ring[0]), IMU_OUT_RING_SIZE, &out_head, r, out);
+}
+
+mpu_data_t mpu_sample_to_data(const mpu_sample_t *s) {
+    return (mpu_data_t){
+        .ax = s->acc[0] / accel_lsb, .ay = s->acc[1] / accel_lsb, .az = s->acc[2] / accel_lsb,
+        .gx = s->gyro[0] / gyro_lsb, .gy = s->gyro[1] / gyro_lsb, .gz = s->gyro[2] / gyro_lsb,
+    };
+}
+
+mpu_data_t mpu_get_data(void) {
+    uint32_t head = __atomic_load_n(&out_head, __ATOMIC_ACQUIRE);
+    if (head == 0) return (mpu_data_t){0};
+    return out_ring[(head - 1) & (IMU_OUT_RING_SIZE - 1)].d;
+}
+
+void mpu_get_stats(mpu_stats_t *st) { *st = stats; }
+
+// --- Calibração da montagem (tarefa principal, uma vez por fix) ---
+
+// Média das amostras brutas desde a última fix (eixos do sensor, LSB)
+static bool cal_drain(float acc[3], float gyro[3]) {
+    int32_t sa[3] = {0}, sg[3] = {0};
+    int n = 0;
+    mpu_sample_t s;
+    while (mpu_read_sample(&cal_rd, &s)) {
+        for (int i = 0; i < 3; i++) { sa[i] += s.acc[i]; sg[i] += s.gyro[i]; }
+        n++;
+    }
+    if (n == 0) return false;
+    for (int i = 0; i < 3; i++) { acc[i] = (float)sa[i] / n; gyro[i] = (float)sg[i] / n; }
+    return true;
+}
+
+static void cal_still_window(void) {
+    if (!cal_done) {
+        // A parada mais recente define gravidade e bias
+        memcpy(cal.still_acc, still_win.still_acc, sizeof(cal.still_acc));
+        memcpy(cal.still_gyro, still_win.still_gyro, sizeof(cal.still_gyro));
+        cal.n_still = still_win.n_still;
+        return;
+    }
+    float up[3];
+    if (!imu_calib_up(&still_win, up)) return;
+    imu_orient_t o = orient[orient_cur];
+    float z = (o.rot[2][0] * up[0] + o.rot[2][1] * up[1] + o.rot[2][2] * up[2]) / (1 << IMU_ORIENT_Q);
+    if (z < cosf(IMU_CAL_MAX_TILT_DEG * (float)M_PI / 180.0f)) {
+        ESP_LOGW(TAG, "Sensor fora da montagem calibrada (%.0f graus): recalibrando", acosf(z > 1 ? 1 : z) * 180.0f / (float)M_PI);
+        cal_done = false;
+        imu_calib_reset(&cal);
+        cal_still_window();
+        return;
+    }
+    // Bias do giro anda com a temperatura: cada parada atualiza (só na RAM)
+    for (int i = 0; i < 3; i++) o.gyro_bias[i] = (int16_t)lroundf(still_win.still_gyro[i] / still_win.n_still);
+    orient_publish(&o);
+}
+
+void mpu_calib_feed(const gps_data_t *fix) {
+    float acc[3], gyro[3];
+    if (!imu_ok || !cal_drain(acc, gyro)) return;
+
+    bool have_a = false;
+    float a_g = 0;
+    if (fix->valid && prev_mms >= 0) {
+        uint32_t dt = fix->timestamp_ms - prev_ms;
+        if (dt > 0 && dt <= 250) { a_g = (float)(fix->speed_mms - prev_mms) / dt / 9.80665f; have_a = true; }
+    }
+    prev_mms = fix->valid ? fix->speed_mms : -1;
+    prev_ms = fix->timestamp_ms;
+
+    // Parada: descarta o primeiro segundo (o kart ainda balança da frenagem)
+    if (fix->valid && fix->speed_mms < IMU_CAL_STILL_MMS) {
+        if (++still_run > GPS_RATE_HZ) imu_calib_add_still(&still_win, acc, gyro);
+        if (still_win.n_still >= IMU_CAL_STILL_FIXES) { cal_still_window(); imu_calib_reset(&still_win); }
+        return;
+    }
+    still_run = 0;
+    imu_calib_reset(&still_win);
+
+    float up[3];
+    if (cal_done || !have_a || fabsf(a_g) < IMU_CAL_MIN_ACCEL_G || !imu_calib_up(&cal, up)) return;
+    float yaw = 0;
+    for (int i = 0; i < 3; i++) yaw += (gyro[i] - (float)(cal.still_gyro[i] / cal.n_still)) * up[i];
+    if (fabsf(yaw / gyro_lsb) > IMU_CAL_MAX_YAW_DPS) return;
+    imu_calib_add_motion(&cal, acc, a_g * accel_lsb);
+
+    imu_orient_t o;
+    double min_energy = IMU_CAL_ENERGY_G2 * accel_lsb * accel_lsb;
+    if (!imu_calib_solve(&cal, min_energy, &o)) {
+        // Muito dado e ainda inconsistente (GPS ruim, pista ondulada): recomeça a frente
+        if (cal.energy > 4 * min_energy) { memset(cal.fwd, 0, sizeof(cal.fwd)); cal.energy = 0; cal.n_motion = 0; }
+        return;
+    }
+    orient_publish(&o);
+    orient_save(&o);
+    cal_done = true;
+    ESP_LOGI(TAG, "Montagem calibrada: %lu amostras paradas, %lu em reta", cal.n_still, cal.n_motion);
 }
 
-void mpu_update(void) {} // Dummy update
-mpu_data_t mpu_get_data(void) { return current_mpu; }
\ No newline at end of file
+bool mpu_is_calibrated(void) { return cal_done; }
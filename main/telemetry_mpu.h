@@ -1,4 +1,58 @@
 #ifndef TELEMETRY_MPU_H
 #define TELEMETRY_MPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry_gps.h"
+
+// g e °/s. Calibrada a montagem, nos eixos do kart: ax longitudinal
+// (+ acelerando), ay lateral (+ para a esquerda), az vertical (+1 g parado);
+// gx/gy/gz são rolagem, arfagem e guinada. Antes disso, eixos do sensor.
 typedef struct { float ax, ay, az; float gx, gy, gz; } mpu_data_t;
-#endif
\ No newline at end of file
+
+// Amostra do anel: bruta, nos eixos do sensor, com o instante estimado
+// da medida (esp_timer em µs, dá a volta a cada ~71 min: use diferenças)
+typedef struct {
+    uint32_t t_us;
+    int16_t acc[3];
+    int16_t gyro[3];
+} mpu_sample_t;
+
+// Amostra filtrada e decimada (IMU_LPF_HZ, 1 kHz / IMU_DECIM), já girada
+typedef struct {
+    uint32_t t_us;
+    mpu_data_t d;
+} mpu_filtered_t;
+
+// Cursor de leitura do anel de amostras (cada consumidor tem o seu)
+typedef struct {
+    uint32_t tail;
+    uint32_t dropped;   // Amostras perdidas por o leitor ter ficado para trás
+} mpu_reader_t;
+
+typedef struct {
+    uint32_t samples;       // Amostras entregues ao anel
+    uint32_t bursts;        // Transações de leitura do FIFO
+    uint32_t overflows;     // FIFO do sensor transbordou (amostras perdidas)
+    uint32_t bus_errors;
+    uint32_t filter_us;     // Tempo total no filtro (medido com esp_timer)
+    uint32_t filter_max_us; // Pior rajada
+} mpu_stats_t;
+
+bool mpu_init(void);        // false = sensor ausente (o resto do sistema segue)
+void mpu_reader_init(mpu_reader_t *r);
+void mpu_filtered_reader_init(mpu_reader_t *r);
+bool mpu_read_sample(mpu_reader_t *r, mpu_sample_t *out);      // Bruta, 1 kHz
+bool mpu_read_filtered(mpu_reader_t *r, mpu_filtered_t *out);  // Filtrada
+mpu_data_t mpu_get_data(void);   // Última amostra filtrada
+mpu_data_t mpu_sample_to_data(const mpu_sample_t *s);
+void mpu_get_stats(mpu_stats_t *st);
+
+// Calibração automática da montagem, chamada uma vez por fix (mesma
+// tarefa sempre). Parado: gravidade e bias do giro; em reta acelerando ou
+// freando: eixo da frente. O resultado vai para o NVS e vale nos boots
+// seguintes; parado e inclinado demais, recomeça.
+void mpu_calib_feed(const gps_data_t *fix);
+bool mpu_is_calibrated(void);
+
+#endif
@@ -1,6 +1,13 @@
 #include "telemetry_sd.h"
 #include "config.h"
-#include "ui_kartbox.h"
+#include "sd_writer.h"
+#include "log_format.h"
+#include "log_codec.h"
+#include "sd_manifest.h"
+#include "sd_summary.h"
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_vfs_fat.h"
 #include "driver/sdmmc_host.h"
@@ -8,18 +15,214 @@
 #include "esp_ldo_regulator.h" 
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "SD";
 
 // Variáveis de estado
 static bool mounted = false;
-static FILE *f_telemetry = NULL;
+static bool session_open = false;  // Log da sessão entregue ao sd_writer
+static uint8_t sample_seq = 0;      // Sequência dos registros (detecta lixo no fim)
 static uint16_t current_session_id = 1;
 static char session_filename[128] = {0}; 
+static sd_session_t cur_session;    // Entrada do manifesto da sessão aberta
+static sd_summary_t cur_summary;    // Voltas da sessão aberta, gravadas no fim
+static int32_t lap_max_mms = 0;     // Velocidade máxima da volta em andamento
+
+// Índice de voltas em montagem: uma entrada por troca do canal lap
+typedef struct { log_lap_index_t *e; uint32_t n, cap; } lap_index_t;
+static lap_index_t cur_index;
+static uint32_t log_pos = 0;        // Offset no .kbl do próximo registro
+// Manifesto é lido pela carga do histórico (tarefa própria da UI) enquanto
+// início/fim de sessão e o apagar mexem nele
+static SemaphoreHandle_t mf_lock = NULL;
+static volatile uint32_t sessions_gen = 0; // Muda a cada sessão aberta, fechada ou apagada
+
+static void mf_take(void) { if (mf_lock) xSemaphoreTake(mf_lock, portMAX_DELAY); }
+static void mf_give(void) { if (mf_lock) xSemaphoreGive(mf_lock); }
 
 // Variável Global para o Handle do Cartão (Usado pelo USB)
 static sdmmc_card_t *card_handle = NULL;
 
+// --- Blocos comprimidos (LOG_FLAG_BLOCKS) ---
+static log_codec_t codec;
+static uint8_t blk_recs[SD_LOG_BLOCK_RECS * LOG_REC_SIZE]; // Registros esperando o bloco fechar
+static uint16_t blk_n = 0;
+static uint32_t blk_t0 = 0;         // t_ms do 1o registro do bloco
+static uint16_t blk_lap = 0;        // Volta do bloco (troca de volta fecha o bloco)
+
+// Lê e valida o bloco em 'pos'. Retorna o nº de registros (-1 = não há
+// bloco íntegro ali: fim do log ou lixo da área pré-alocada).
+static int sd_read_block(int fd, uint32_t pos, uint8_t *buf, size_t cap, uint8_t *recs, size_t *used) {
+    if (lseek(fd, pos, SEEK_SET) < 0 || read(fd, buf, LOG_BLOCK_HDR_SIZE) != LOG_BLOCK_HDR_SIZE) return -1;
+    size_t payload = buf[4] | buf[5] << 8;
+    if (LOG_BLOCK_HDR_SIZE + payload > cap || read(fd, buf + LOG_BLOCK_HDR_SIZE, payload) != (ssize_t)payload) return -1;
+    return log_block_decode(&codec, buf, LOG_BLOCK_HDR_SIZE + payload, recs, SD_LOG_BLOCK_RECS, used);
+}
+
+// --- Recuperação de sessões interrompidas ---
+// Sessão fechada normalmente tem tamanho == bytes confirmados no cabeçalho.
+// Se sobrou área pré-alocada (ou o tamanho não bate), corta no último
+// checkpoint e estende enquanto a cadeia continuar: registro a registro
+// pela sequência, ou bloco a bloco pelo CRC no log comprimido. O que
+// chegou ao cartão depois do último fsync também volta.
+static void sd_recover_session(const char *path) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return;
+    uint8_t hdr[32];
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < LOG_HDR_SIZE || lseek(fd, 0, SEEK_SET) != 0 || read(fd, hdr, sizeof(hdr)) != sizeof(hdr) ||
+        memcmp(hdr, LOG_MAGIC, 4) != 0) { close(fd); return; }
+    uint32_t rec_size = hdr[8] | hdr[9] << 8, hdr_size = hdr[6] | hdr[7] << 8;
+    uint32_t len = hdr[24] | hdr[25] << 8 | hdr[26] << 16 | (uint32_t)hdr[27] << 24;
+    if (len == (uint32_t)size || rec_size != LOG_REC_SIZE) { close(fd); return; }
+    if (len < hdr_size || len > (uint32_t)size) len = hdr_size;
+
+    uint32_t pos = len;
+    if (hdr[11] & LOG_FLAG_BLOCKS) {
+        // Checkpoints só caem entre blocos: 'len' já é início de bloco
+        size_t cap = LOG_BLOCK_MAX_SIZE(&codec, SD_LOG_BLOCK_RECS), used;
+        uint8_t *buf = malloc(cap), *recs = malloc(sizeof(blk_recs));
+        while (buf && recs && sd_read_block(fd, pos, buf, cap, recs, &used) >= 0) pos += used;
+        free(buf);
+        free(recs);
+    } else {
+        len = hdr_size + (len - hdr_size) / LOG_REC_SIZE * LOG_REC_SIZE;
+        pos = len;
+        uint8_t prev[LOG_REC_SIZE] = {0}, chunk[64 * LOG_REC_SIZE];
+        bool chain;
+        if (len == hdr_size) {
+            // Nunca sincronizada: o 1o registro tem seq 0 e t_ms perto do início
+            memcpy(prev, hdr + 20, 4);
+            prev[15] = LOG_SEQ_MASK << 4;
+        } else if (lseek(fd, len - LOG_REC_SIZE, SEEK_SET) < 0 || read(fd, prev, LOG_REC_SIZE) != LOG_REC_SIZE) {
+            close(fd);
+            return;
+        }
+        int n;
+        chain = lseek(fd, len, SEEK_SET) >= 0;
+        while (chain && (n = read(fd, chunk, sizeof(chunk))) >= LOG_REC_SIZE) {
+            for (int i = 0; i + LOG_REC_SIZE <= n; i += LOG_REC_SIZE) {
+                if (!log_record_follows(prev, chunk + i)) { chain = false; break; }
+                memcpy(prev, chunk + i, LOG_REC_SIZE);
+                pos += LOG_REC_SIZE;
+            }
+        }
+    }
+
+    uint8_t le[4] = { pos, pos >> 8, pos >> 16, pos >> 24 };
+    if (ftruncate(fd, pos) == 0 && lseek(fd, LOG_LEN_OFFSET, SEEK_SET) >= 0 && write(fd, le, 4) == 4) {
+        ESP_LOGW(TAG, "Sessão recuperada: %s (%lu de %lu bytes, %lu após o último checkpoint)",
+                 path, pos, (uint32_t)size, pos - len);
+    }
+    fsync(fd);
+    close(fd);
+}
+
+static void sd_recover_data(const char *name) {
+    char path[128]; snprintf(path, sizeof(path), "/sdcard/data_%s.kbl", name);
+    sd_recover_session(path);
+}
+
+// --- Índice de voltas ---
+static void lap_index_note(lap_index_t *ix, uint16_t lap, uint32_t offset, uint32_t count) {
+    if (ix->n && ix->e[ix->n - 1].lap == lap) { ix->e[ix->n - 1].count += count; return; }
+    if (ix->n == ix->cap) {
+        uint32_t cap = ix->cap ? ix->cap * 2 : 64;
+        log_lap_index_t *p = realloc(ix->e, cap * sizeof(log_lap_index_t));
+        if (!p) return;
+        ix->e = p;
+        ix->cap = cap;
+    }
+    ix->e[ix->n++] = (log_lap_index_t){ .lap = lap, .offset = offset, .count = count };
+}
+
+// Fecha o bloco pendente e entrega ao sd_writer (bloco inteiro ou nada).
+// O índice só conta o bloco que o sd_writer aceitou.
+static void sd_flush_block(void) {
+    if (!blk_n) return;
+    static uint8_t out[LOG_BLOCK_HDR_SIZE + SD_LOG_BLOCK_RECS * LOG_CODEC_MAX_FIELDS * 5];
+    size_t len = log_block_encode(&codec, blk_recs, blk_n, out, sizeof(out));
+    if (len && sd_writer_put(out, len)) {
+        lap_index_note(&cur_index, blk_lap, log_pos, blk_n);
+        log_pos += len;
+    }
+    blk_n = 0;
+}
+
+static bool lap_index_write(const lap_index_t *ix, const char *name) {
+    char path[128]; snprintf(path, sizeof(path), "/sdcard/idx_%s.kbi", name);
+    uint8_t hdr[LOG_IDX_HDR_SIZE];
+    log_build_index_header(hdr, ix->n);
+    FILE *f = fopen(path, "wb"); if (!f) return false;
+    bool ok = fwrite(hdr, sizeof(hdr), 1, f) == 1 && (!ix->n || fwrite(ix->e, sizeof(log_lap_index_t), ix->n, f) == ix->n);
+    if (fclose(f) != 0) ok = false;
+    if (!ok) remove(path);
+    return ok;
+}
+
+// --- Manifesto de sessões ---
+// Conta as voltas e acha a melhor num laps_*.csv (só para sessões sem
+// fechamento registrado: importação inicial e desligamento no meio)
+static void sd_scan_laps_file(const char *name, uint16_t *laps, uint32_t *best) {
+    char path[128]; snprintf(path, sizeof(path), "/sdcard/laps_%s.csv", name);
+    FILE *f = fopen(path, "r"); if (!f) return;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        int lap; unsigned long s, ms;
+        if (sscanf(line, "%d,%lu.%lu", &lap, &s, &ms) < 3) continue;
+        uint32_t t = s * 1000 + ms;
+        *laps = lap;
+        if (*best == 0 || t < *best) *best = t;
+    }
+    fclose(f);
+}
+
+static uint32_t sd_data_size(const char *name) {
+    char path[128]; snprintf(path, sizeof(path), "/sdcard/data_%s.kbl", name);
+    struct stat st;
+    return (stat(path, &st) == 0) ? (uint32_t)st.st_size : 0;
+}
+
+static void sd_manifest_init(void) {
+    if (!sd_manifest_load(SD_MANIFEST_PATH)) {
+        // Primeira vez com manifesto: importa as sessões antigas (única varredura)
+        DIR *dir = opendir("/sdcard"); if (!dir) return;
+        struct dirent *ent;
+        uint16_t legacy_id = 0x8000;
+        while ((ent = readdir(dir))) {
+            char *end = strstr(ent->d_name, ".csv");
+            if (strncmp(ent->d_name, "laps_", 5) != 0 || !end) continue;
+            sd_session_t e = { .id = legacy_id++, .state = SD_SESSION_CLOSED };
+            size_t len = end - (ent->d_name + 5);
+            if (len >= sizeof(e.name)) len = sizeof(e.name) - 1;
+            memcpy(e.name, ent->d_name + 5, len);
+            sd_recover_data(e.name);
+            sd_scan_laps_file(e.name, &e.laps, &e.best_ms);
+            e.bytes = sd_data_size(e.name);
+            sd_manifest_put(&e);
+        }
+        closedir(dir);
+        ESP_LOGI(TAG, "Manifesto criado com %d sessões existentes", sd_manifest_count());
+        return;
+    }
+    // Sessões que ficaram abertas (desligamento): recupera o log e fecha
+    // com o que sobrou. As fechadas não são nem abertas.
+    for (int i = 0; i < sd_manifest_count(); i++) {
+        const sd_session_t *e = sd_manifest_get(i);
+        if (e->state != SD_SESSION_OPEN) continue;
+        sd_session_t c = *e;
+        c.state = SD_SESSION_CLOSED;
+        sd_recover_data(c.name);
+        sd_scan_laps_file(c.name, &c.laps, &c.best_ms);
+        c.bytes = sd_data_size(c.name);
+        sd_manifest_put(&c);
+    }
+}
+
 bool sd_init(void) {
     // Configuração do LDO (Regulador)
     esp_ldo_channel_handle_t ldo_h;
@@ -48,6 +251,11 @@ bool sd_init(void) {
 
     mounted = true;
     card_handle = card_temp; // <--- SALVA O HANDLE AQUI PARA O USB USAR
+    uint8_t widths[LOG_CODEC_MAX_FIELDS];
+    log_codec_init(&codec, widths, log_field_widths(widths));
+    if (!mf_lock) mf_lock = xSemaphoreCreateMutex();
+    sd_manifest_init(); // Antes de qualquer sessão nova: corta o que um desligamento deixou
+    sd_writer_init();
     
     FILE *f = fopen("/sdcard/last_id.txt", "r");
     if (f) { fscanf(f, "%hu", &current_session_id); fclose(f); }
@@ -60,8 +268,8 @@ sdmmc_card_t* sd_get_card_handle(void) {
     return card_handle;
 }
 
-void sd_start_new_session(gps_data_t gps) {
-    if (f_telemetry) fclose(f_telemetry);
+void sd_start_new_session(gps_data_t gps, const char *track) {
+    sd_stop_session();
     current_session_id++;
     
     FILE *f_id = fopen("/sdcard/last_id.txt", "w");
@@ -70,131 +278,151 @@ void sd_start_new_session(gps_data_t gps) {
     if (gps.valid) snprintf(session_filename, 128, "20%02d%02d%02d_%02d%02d", gps.year, gps.month, gps.day, gps.hour, gps.minute);
     else snprintf(session_filename, 128, "RUN_%03d", current_session_id);
     
-    char path[256]; snprintf(path, 256, "/sdcard/data_%s.csv", session_filename);
-    f_telemetry = fopen(path, "w");
-    
-    if (f_telemetry) {
-        fprintf(f_telemetry, "Timestamp_ms,Date,Time,Mode,Lap,Speed,Lat,Lon\n");
+    char path[256]; snprintf(path, 256, "/sdcard/data_%s.kbl", session_filename);
+    // Reserva a extensão inteira agora (f_expand): durante a sessão o FATFS
+    // só escreve em clusters já alocados, sem tocar na FAT a cada cluster.
+    // Cartão fragmentado demais cai no arquivo comum, que cresce sob demanda.
+    bool prealloc = esp_vfs_fat_create_contiguous_file("/sdcard", path, SD_SESSION_PREALLOC, true) == ESP_OK;
+    if (!prealloc) ESP_LOGW(TAG, "Sem espaço contíguo para %s, gravando sem pré-alocação", path);
+    int fd = open(path, prealloc ? O_WRONLY : (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+    session_open = sd_writer_open(fd, prealloc ? SD_SESSION_PREALLOC : 0, LOG_LEN_OFFSET);
+    if (!session_open) { if (fd >= 0) close(fd); return; }
+
+    uint8_t header[LOG_HDR_SIZE];
+    sd_writer_put(header, log_build_header(header, current_session_id, &gps, SD_LOG_COMPRESS ? LOG_FLAG_BLOCKS : 0));
+    sample_seq = 0;
+
+    cur_session = (sd_session_t){ .id = current_session_id, .state = SD_SESSION_OPEN,
+                                  .year = gps.year, .month = gps.month, .day = gps.day,
+                                  .hour = gps.hour, .minute = gps.minute, .second = gps.second };
+    snprintf(cur_session.name, sizeof(cur_session.name), "%s", session_filename);
+    if (track) snprintf(cur_session.track, sizeof(cur_session.track), "%s", track);
+    mf_take(); sd_manifest_put(&cur_session); sessions_gen++; mf_give();
+    sd_summary_reset(&cur_summary);
+    lap_max_mms = 0;
+    cur_index.n = 0;
+    log_pos = LOG_HDR_SIZE;
+    blk_n = 0;
+
+    // Arquivo de voltas aberto uma vez por sessão, já com o cabeçalho
+    snprintf(path, 256, "/sdcard/laps_%s.csv", session_filename);
+    int fl = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (sd_writer_open_aux(fl)) {
+        static const char laps_header[] = "Lap,Time,Avg_Speed,Mode,Date,Time_of_Day,Sectors,Estimated\n";
+        sd_writer_put_aux(laps_header, sizeof(laps_header) - 1);
+    } else if (fl >= 0) {
+        close(fl);
     }
 }
 
-void sd_stop_session(void) { if (f_telemetry) { fclose(f_telemetry); f_telemetry = NULL; } }
+void sd_stop_session(void) {
+    if (!session_open) return;
+    sd_flush_block();
+    sd_writer_close();
+    session_open = false;
+    sd_writer_stats_t st;
+    sd_writer_get_stats(&st);
+    cur_session.state = SD_SESSION_CLOSED;
+    cur_session.bytes = st.bytes;
+    mf_take(); sd_manifest_put(&cur_session); sessions_gen++; mf_give();
 
-void sd_save_lap_event(uint16_t lap, uint32_t ms, float avg_speed, gps_data_t gps, race_mode_t mode) {
-    if (!mounted) return;
-    char path[256]; snprintf(path, 256, "/sdcard/laps_%s.csv", session_filename);
-    
-    FILE *check = fopen(path, "r");
-    bool new_file = (check == NULL);
-    if (check) fclose(check);
-
-    FILE *fl = fopen(path, "a+");
-    if (fl) { 
-        if (new_file) {
-            fprintf(fl, "Lap,Time,Avg_Speed,Mode,Date,Time_of_Day\n");
-        }
-        
-        char time_str[16];
-        snprintf(time_str, 16, "%02d:%02d:%02d", gps.hour, gps.minute, gps.second);
-        
-        fprintf(fl, "%d,%lu.%03lu,%.1f,%s,%02d/%02d/%02d,%s\n", 
-                lap, ms/1000, ms%1000, avg_speed, 
-                (mode == MODE_CLASSIFICACAO ? "QUALY" : "RACE"),
-                gps.day, gps.month, gps.year,
-                time_str);
-        
-        fclose(fl); 
+    char path[128]; snprintf(path, sizeof(path), "/sdcard/sum_%s.kbs", cur_session.name);
+    if (!sd_summary_write(&cur_summary, path)) ESP_LOGW(TAG, "Falha ao gravar o resumo %s", path);
+    if (!lap_index_write(&cur_index, cur_session.name)) ESP_LOGW(TAG, "Falha ao gravar o índice de voltas");
+}
+
+void sd_save_lap_event(uint16_t lap, uint32_t ms, float avg_speed, gps_data_t gps, race_mode_t mode, const uint32_t *sectors, uint8_t n_sectors, bool estimated) {
+    if (!mounted || !session_open) return;
+    cur_session.laps = lap;
+    if (cur_session.best_ms == 0 || ms < cur_session.best_ms) cur_session.best_ms = ms;
+    sd_summary_add_lap(&cur_summary, ms, avg_speed, lap_max_mms * 0.0036f, sectors, n_sectors);
+    lap_max_mms = 0;
+    // Formata aqui (uma vez por volta) e entrega a linha pronta ao sd_writer
+    char line[SD_AUX_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "%d,%lu.%03lu,%.1f,%s,%02d/%02d/%02d,%02d:%02d:%02d,",
+                     lap, ms/1000, ms%1000, avg_speed,
+                     (mode == MODE_CLASSIFICACAO ? "QUALY" : "RACE"),
+                     gps.day, gps.month, gps.year,
+                     gps.hour, gps.minute, gps.second);
+    // Setores separados por ';' numa coluna só (quantidade varia por pista)
+    for (uint8_t i = 0; i < n_sectors && n < (int)sizeof(line) - 16; i++) {
+        n += snprintf(line + n, sizeof(line) - n, "%s%lu.%03lu", i ? ";" : "", sectors[i]/1000, sectors[i]%1000);
     }
+    n += snprintf(line + n, sizeof(line) - n, ",%d\n", estimated ? 1 : 0);
+    sd_writer_put_aux(line, n);
 }
 
 int sd_get_available_sessions(uint16_t *session_list, int max) {
     if (!mounted) return 0;
-    DIR *dir = opendir("/sdcard"); if (!dir) return 0;
-    struct dirent *ent; int count = 0;
-    while ((ent = readdir(dir)) && count < max) {
-        if (strstr(ent->d_name, "laps_")) { session_list[count] = count + 1; count++; }
-    }
-    closedir(dir); return count;
+    mf_take();
+    int n = sd_manifest_count();
+    if (n > max) n = max;
+    for (int i = 0; i < n; i++) session_list[i] = sd_manifest_get(i)->id;
+    mf_give();
+    return n;
 }
 
-int sd_get_session_string_list(char *buffer, size_t max_len) {
+int sd_get_session_string_list(char *buffer, size_t max_len, uint16_t *ids, int max_ids) {
     if (!mounted || !buffer) return 0;
     buffer[0] = '\0';
-    
-    DIR *dir = opendir("/sdcard");
-    if (!dir) return 0;
-    
-    struct dirent *ent;
-    int count = 0;
     size_t current_len = 0;
-    
-    while ((ent = readdir(dir))) {
-        if (strstr(ent->d_name, "laps_") && strstr(ent->d_name, ".csv")) {
-            char clean_name[64];
-            char *start = ent->d_name + 5; 
-            char *end = strstr(ent->d_name, ".csv");
-            
-            if (start && end && end > start) {
-                size_t len = end - start;
-                if (len > sizeof(clean_name) - 1) len = sizeof(clean_name) - 1;
-                memcpy(clean_name, start, len);
-                clean_name[len] = '\0'; 
-            } else {
-                snprintf(clean_name, sizeof(clean_name), "%s", ent->d_name);
-            }
-            
-            size_t added = snprintf(buffer + current_len, max_len - current_len, "%s\n", clean_name);
-            if (added > 0) {
-                current_len += added;
-                if (current_len >= max_len - 1) break;
-            }
-            count++;
-        }
-    }
-    closedir(dir);
-    
-    if (current_len > 0 && buffer[current_len - 1] == '\n') {
-        buffer[current_len - 1] = '\0';
+    int count = 0;
+    // Mais recente primeiro; nomes e ids lidos juntos, sob o mesmo lock
+    mf_take();
+    for (; count < sd_manifest_count() && count < max_ids; count++) {
+        const sd_session_t *e = sd_manifest_get(count);
+        int added = snprintf(buffer + current_len, max_len - current_len, "%s%s", count ? "\n" : "", e->name);
+        if (added < 0 || current_len + added >= max_len - 1) break;
+        current_len += added;
+        ids[count] = e->id;
     }
+    mf_give();
     return count;
 }
 
-void sd_load_session_history(uint16_t idx) {
-    if (!mounted) return;
-    DIR *dir = opendir("/sdcard"); if (!dir) return;
-    struct dirent *ent; int count = 0; char target[256] = "";
-    
-    while ((ent = readdir(dir))) {
-        if (strstr(ent->d_name, "laps_") && strstr(ent->d_name, ".csv")) {
-            if (count == idx) { snprintf(target, 256, "/sdcard/%s", ent->d_name); break; }
-            count++;
-        }
-    }
-    closedir(dir);
-    
-    if (strlen(target) == 0) return;
-    
-    FILE *f = fopen(target, "r"); if (!f) return;
-    char line[128];
-    char first_line[128];
-    if (fgets(first_line, 128, f)) {
-        if (strstr(first_line, "Lap") == NULL) {
-             int lap; unsigned long s, ms; float avg;
-             if (sscanf(first_line, "%d,%lu.%lu,%f", &lap, &s, &ms, &avg) >= 4) {
-                 ui_add_lap_to_list(lap, (s * 1000) + ms);
-                 ui_add_point_to_chart(avg);
-             }
-        }
-    }
-
-    while (fgets(line, 128, f)) {
+// Sessão sem resumo (anterior ao formato ou cortada por desligamento):
+// monta a partir do CSV de voltas e grava, para a próxima vez ser direta.
+// Sessão ainda aberta não grava: o resumo dela sai no sd_stop_session.
+static bool sd_summary_from_csv(sd_summary_t *sum, const char *name, bool cache) {
+    char path[128]; snprintf(path, sizeof(path), "/sdcard/laps_%s.csv", name);
+    FILE *f = fopen(path, "r"); if (!f) return false;
+    memset(sum, 0, sizeof(*sum));
+    char line[SD_AUX_LINE_MAX];
+    while (fgets(line, sizeof(line), f)) {
         int lap; unsigned long s, ms; float avg;
-        if (sscanf(line, "%d,%lu.%lu,%f", &lap, &s, &ms, &avg) >= 4) {
-            ui_add_lap_to_list(lap, (s * 1000) + ms);
-            ui_add_point_to_chart(avg);
+        if (sscanf(line, "%d,%lu.%lu,%f", &lap, &s, &ms, &avg) < 4) continue;
+        // Coluna de setores: "s.mmm;s.mmm;..." depois da 6a vírgula
+        uint32_t sec[SECTOR_MAX]; uint8_t n_sec = 0;
+        char *p = line;
+        for (int c = 0; c < 6 && p; c++) { p = strchr(p, ','); if (p) p++; }
+        while (p && n_sec < SECTOR_MAX) {
+            unsigned long ss, sms;
+            if (sscanf(p, "%lu.%lu", &ss, &sms) != 2) break;
+            sec[n_sec++] = ss * 1000 + sms;
+            p = strchr(p, ';'); if (p) p++;
         }
+        sd_summary_add_lap(sum, s * 1000 + ms, avg, 0.0f, sec, n_sec);
     }
     fclose(f);
+    snprintf(path, sizeof(path), "/sdcard/sum_%s.kbs", name);
+    if (cache) sd_summary_write(sum, path);
+    else sd_summary_finish(sum);
+    return true;
+}
+
+bool sd_read_session_summary(uint16_t id, sd_summary_t *sum) {
+    if (!mounted) return false;
+    mf_take();
+    const sd_session_t *p = sd_manifest_find(id);
+    sd_session_t e = p ? *p : (sd_session_t){0};
+    bool live = p && session_open && e.id == cur_session.id;
+    mf_give();
+    if (!p) return false;
+
+    // Sessão gravando agora: o resumo dela só existe no fim, lê o CSV
+    char path[128]; snprintf(path, sizeof(path), "/sdcard/sum_%s.kbs", e.name);
+    if (!live && sd_summary_read(sum, path)) return true;
+    return sd_summary_from_csv(sum, e.name, !live);
 }
 
 void sd_get_info(float *used_gb, float *total_gb) {
@@ -208,29 +436,49 @@ void sd_get_info(float *used_gb, float *total_gb) {
 }
 
 void sd_log_sample(gps_data_t gps, mpu_data_t mpu, race_mode_t mode, uint16_t lap) {
-    if (f_telemetry) {
-        fprintf(f_telemetry, "%lu,%02d/%02d/%02d,%02d:%02d:%02d,%s,%d,%.1f,%.6f,%.6f\n", 
-                gps.timestamp_ms,
-                gps.day, gps.month, gps.year,
-                gps.hour, gps.minute, gps.second,
-                (mode == MODE_CLASSIFICACAO ? "QUALY" : "RACE"),
-                lap,
-                gps.speed_kmh,
-                gps.lat, gps.lon);
+    if (!session_open) return;
+    if (gps.speed_mms > lap_max_mms) lap_max_mms = gps.speed_mms;
+    uint8_t rec[LOG_REC_SIZE];
+    log_encode_sample(rec, &gps, mode, lap, sample_seq);
+    if (!SD_LOG_COMPRESS) {
+        // Só memcpy: a gravação é da writer_task. A sequência só avança no que
+        // entrou, para a cadeia da recuperação não quebrar num descarte.
+        if (!sd_writer_put(rec, sizeof(rec))) return;
+        sample_seq++;
+        lap_index_note(&cur_index, lap, log_pos, 1);
+        log_pos += sizeof(rec);
+        return;
     }
+    // Comprimido: cada volta começa num bloco novo (seek do índice), e um
+    // bloco não segura amostras além do intervalo de checkpoint
+    if (blk_n && (blk_lap != lap || gps.timestamp_ms - blk_t0 >= SD_SYNC_INTERVAL_MS)) sd_flush_block();
+    if (blk_n == 0) { blk_t0 = gps.timestamp_ms; blk_lap = lap; }
+    memcpy(blk_recs + blk_n * LOG_REC_SIZE, rec, LOG_REC_SIZE);
+    sample_seq++;
+    if (++blk_n == SD_LOG_BLOCK_RECS) sd_flush_block();
 }
 
 void sd_delete_all_sessions(void) {
-    DIR *dir = opendir("/sdcard"); if (!dir) return;
-    struct dirent *ent;
-    while ((ent = readdir(dir))) {
-        if (strstr(ent->d_name, ".csv")) {
-            char p[256]; snprintf(p, 256, "/sdcard/%s", ent->d_name); unlink(p);
-        }
+    if (!mounted) return;
+    mf_take();
+    for (int i = 0; i < sd_manifest_count(); i++) {
+        const sd_session_t *e = sd_manifest_get(i);
+        if (session_open && e->id == cur_session.id) continue; // Sessão gravando agora fica
+        char p[128];
+        snprintf(p, sizeof(p), "/sdcard/data_%s.kbl", e->name); unlink(p);
+        snprintf(p, sizeof(p), "/sdcard/data_%s.csv", e->name); unlink(p);
+        snprintf(p, sizeof(p), "/sdcard/laps_%s.csv", e->name); unlink(p);
+        snprintf(p, sizeof(p), "/sdcard/sum_%s.kbs", e->name); unlink(p);
+        snprintf(p, sizeof(p), "/sdcard/idx_%s.kbi", e->name); unlink(p);
     }
-    closedir(dir);
+    sd_manifest_clear();
+    if (session_open) sd_manifest_put(&cur_session);
+    sessions_gen++;
+    mf_give();
 }
 
 uint16_t sd_get_current_session_id(void) { 
     return current_session_id; 
-}
\ No newline at end of file
+}
+
+uint32_t sd_get_sessions_gen(void) { return sessions_gen; }
\ No newline at end of file
@@ -6,26 +6,32 @@
 #include <stddef.h>
 #include "telemetry_gps.h"
 #include "telemetry_mpu.h"
+#include "sd_summary.h"
 #include "driver/sdmmc_host.h" // <--- Importante para o tipo sdmmc_card_t
 
 // Inicializa o cartão SD
 bool sd_init(void);
 
 // Inicia/Para sessões
-void sd_start_new_session(gps_data_t gps);
+void sd_start_new_session(gps_data_t gps, const char *track); // track: nome da pista ou NULL
 void sd_stop_session(void);
 
 // Gravação de dados
 void sd_log_sample(gps_data_t gps, mpu_data_t mpu, race_mode_t mode, uint16_t lap);
-void sd_save_lap_event(uint16_t lap, uint32_t ms, float avg_speed, gps_data_t gps, race_mode_t mode);
+// 'estimated': a largada ou a chegada da volta saiu de posição estimada
+void sd_save_lap_event(uint16_t lap, uint32_t ms, float avg_speed, gps_data_t gps, race_mode_t mode, const uint32_t *sectors, uint8_t n_sectors, bool estimated);
 
 // Gerenciamento de arquivos
 int sd_get_available_sessions(uint16_t *session_list, int max);
-int sd_get_session_string_list(char *buffer, size_t max_len);
-void sd_load_session_history(uint16_t idx);
+// Nomes separados por '\n' (mais recente primeiro) e o id de cada um em 'ids'
+int sd_get_session_string_list(char *buffer, size_t max_len, uint16_t *ids, int max_ids);
+// Resumo da sessão pelo id (bloqueia no SD: chamar fora da UI).
+// Liberar com sd_summary_free.
+bool sd_read_session_summary(uint16_t id, sd_summary_t *sum);
 void sd_delete_all_sessions(void);
 void sd_get_info(float *used_gb, float *total_gb);
 uint16_t sd_get_current_session_id(void);
+uint32_t sd_get_sessions_gen(void);  // Muda quando a lista de sessões muda
 
 // --- NOVO: Função para o USB pegar o controle do cartão ---
 sdmmc_card_t* sd_get_card_handle(void);
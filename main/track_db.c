@@ -0,0 +1,313 @@
+#include "track_db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TDB_MAGIC      "KTDB"
+#define TDB_VERSION    1
+#define TDB_HDR_SIZE   32
+#define TDB_BKT_SIZE   12
+#define TDB_REC_SIZE   128
+#define TDB_REC_KEY    124  // Célula gravada no fim de cada registro
+#define TDB_READ_RECS  8    // Registros lidos por fread numa célula
+#define TDB_NEAR_MAX   16   // Linhas das 9 células em volta guardadas na RAM
+
+#define TDB_LAT_BITS   (TRACK_GEOHASH_BITS / 2)       // 12
+#define TDB_LON_BITS   (TRACK_GEOHASH_BITS - TDB_LAT_BITS) // 13
+
+typedef struct { uint32_t key1, first, count; } tdb_bucket_t; // key1 = célula + 1 (0 = vazio)
+
+static char db_path[64];
+static tdb_bucket_t *buckets = NULL;
+static uint32_t n_buckets = 0, n_tracks = 0, rec_off = 0;
+static uint8_t bucket_shift = 32;
+
+// Linhas de chegada das células em volta da última consultada. Enquanto o
+// kart não sai da célula, a busca é só conta: o cartão só é lido de novo
+// para decodificar uma pista que casou.
+typedef struct { int32_t lat_e7, lon_e7; uint32_t idx; } tdb_near_t;
+static tdb_near_t near[TDB_NEAR_MAX];
+static uint32_t near_cell1 = 0;         // Célula central + 1 (0 = vazio)
+static uint8_t near_n = 0;
+
+// --- Serialização little-endian ---
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put_u32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static uint16_t get_u16(const uint8_t *p) { return p[0] | (uint16_t)p[1] << 8; }
+static uint32_t get_u32(const uint8_t *p) { return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+static void tdb_encode(uint8_t *r, const track_t *t) {
+    memset(r, 0, TDB_REC_SIZE);
+    memcpy(r, t->name, TRACK_NAME_LEN - 1);
+    put_u32(r + 32, (uint32_t)t->lat_e7);
+    put_u32(r + 36, (uint32_t)t->lon_e7);
+    put_u16(r + 40, t->heading_cd);
+    uint8_t n = (t->n_splits > TRACK_MAX_SPLITS) ? TRACK_MAX_SPLITS : t->n_splits;
+    r[42] = n;
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t *s = r + 44 + i * 10;
+        put_u32(s, (uint32_t)t->splits[i].x_cm);
+        put_u32(s + 4, (uint32_t)t->splits[i].y_cm);
+        put_u16(s + 8, t->splits[i].heading_cd);
+    }
+    put_u32(r + TDB_REC_KEY, track_geohash(t->lat_e7, t->lon_e7));
+}
+
+static void tdb_decode(const uint8_t *r, track_t *t) {
+    memcpy(t->name, r, TRACK_NAME_LEN);
+    t->name[TRACK_NAME_LEN - 1] = '\0';
+    t->lat_e7 = (int32_t)get_u32(r + 32);
+    t->lon_e7 = (int32_t)get_u32(r + 36);
+    t->heading_cd = get_u16(r + 40);
+    t->n_splits = (r[42] > TRACK_MAX_SPLITS) ? TRACK_MAX_SPLITS : r[42];
+    for (uint8_t i = 0; i < t->n_splits; i++) {
+        const uint8_t *s = r + 44 + i * 10;
+        t->splits[i].x_cm = (int32_t)get_u32(s);
+        t->splits[i].y_cm = (int32_t)get_u32(s + 4);
+        t->splits[i].heading_cd = get_u16(s + 8);
+    }
+}
+
+// --- Geohash inteiro ---
+static void tdb_cell(int32_t lat_e7, int32_t lon_e7, int32_t *la, int32_t *lo) {
+    int64_t a = ((int64_t)lat_e7 + 900000000) * (1 << TDB_LAT_BITS) / 1800000000;
+    int64_t o = ((int64_t)lon_e7 + 1800000000) * (1 << TDB_LON_BITS) / 3600000000LL;
+    *la = (a < 0) ? 0 : (a >= (1 << TDB_LAT_BITS)) ? (1 << TDB_LAT_BITS) - 1 : (int32_t)a;
+    *lo = (int32_t)(o & ((1 << TDB_LON_BITS) - 1));
+}
+
+static uint32_t tdb_interleave(uint32_t la, uint32_t lo) {
+    uint32_t h = 0;
+    for (int i = TDB_LON_BITS - 1; i >= 0; i--) {
+        h = (h << 1) | ((lo >> i) & 1);
+        if (i > 0) h = (h << 1) | ((la >> (i - 1)) & 1);
+    }
+    return h;
+}
+
+uint32_t track_geohash(int32_t lat_e7, int32_t lon_e7) {
+    int32_t la, lo;
+    tdb_cell(lat_e7, lon_e7, &la, &lo);
+    return tdb_interleave((uint32_t)la, (uint32_t)lo);
+}
+
+// --- Tabela hash (endereçamento aberto, sondagem linear) ---
+static uint32_t tdb_slot(uint32_t key) { return (key * 2654435761u) >> bucket_shift; }
+
+static const tdb_bucket_t *tdb_lookup(uint32_t key) {
+    for (uint32_t i = tdb_slot(key), n = 0; n < n_buckets; i = (i + 1) & (n_buckets - 1), n++) {
+        if (buckets[i].key1 == 0) return NULL;
+        if (buckets[i].key1 == key + 1) return &buckets[i];
+    }
+    return NULL;
+}
+
+static uint8_t tdb_shift_for(uint32_t n) {
+    uint8_t bits = 0;
+    while ((1u << bits) < n) bits++;
+    return (uint8_t)(32 - bits);
+}
+
+void track_db_close(void) {
+    free(buckets);
+    buckets = NULL;
+    n_buckets = n_tracks = 0;
+    near_cell1 = 0;
+}
+
+// Troca do arquivo no track_db_add: banco -> .bak, .tmp -> banco, apaga
+// o .bak. Um corte entre os renames deixa só o .bak, que volta aqui.
+static void tdb_recover(void) {
+    char bak[72];
+    snprintf(bak, sizeof(bak), "%s.bak", db_path);
+    FILE *f = fopen(db_path, "rb");
+    if (f) { fclose(f); remove(bak); return; }
+    rename(bak, db_path);
+}
+
+bool track_db_open(const char *path) {
+    track_db_close();
+    if (path != db_path) snprintf(db_path, sizeof(db_path), "%s", path);
+    tdb_recover();
+    // O arquivo só fica aberto durante cada leitura: o VFS tem poucos
+    // descritores e o log da sessão, o de voltas e o manifesto já usam
+    FILE *db = fopen(path, "rb");
+    if (!db) return false;
+
+    uint8_t hdr[TDB_HDR_SIZE];
+    if (fread(hdr, 1, TDB_HDR_SIZE, db) != TDB_HDR_SIZE || memcmp(hdr, TDB_MAGIC, 4) != 0 ||
+        get_u16(hdr + 4) != TDB_VERSION || get_u16(hdr + 6) != TDB_REC_SIZE) {
+        fclose(db);
+        return false;
+    }
+    n_tracks = get_u32(hdr + 8);
+    uint32_t nb = get_u32(hdr + 12);
+    if (nb == 0 || (nb & (nb - 1)) != 0) { fclose(db); n_tracks = 0; return false; }
+
+    // Só a tabela de células é lida; os registros ficam no cartão
+    uint8_t *raw = malloc((size_t)nb * TDB_BKT_SIZE);
+    buckets = malloc((size_t)nb * sizeof(tdb_bucket_t));
+    bool ok = raw && buckets && fread(raw, TDB_BKT_SIZE, nb, db) == nb;
+    fclose(db);
+    if (!ok) {
+        free(raw);
+        track_db_close();
+        return false;
+    }
+    for (uint32_t i = 0; i < nb; i++) {
+        const uint8_t *b = raw + i * TDB_BKT_SIZE;
+        buckets[i] = (tdb_bucket_t){ get_u32(b), get_u32(b + 4), get_u32(b + 8) };
+    }
+    free(raw);
+    n_buckets = nb;
+    bucket_shift = tdb_shift_for(nb);
+    rec_off = TDB_HDR_SIZE + nb * TDB_BKT_SIZE;
+    return true;
+}
+
+uint32_t track_db_count(void) { return n_tracks; }
+
+static bool tdb_read_rec(FILE *db, uint32_t idx, uint8_t *rec, uint32_t n) {
+    return fseek(db, (long)rec_off + (long)idx * TDB_REC_SIZE, SEEK_SET) == 0 &&
+           fread(rec, TDB_REC_SIZE, n, db) == n;
+}
+
+// Consulta pela cache da célula: distância só com as coordenadas na RAM
+static bool tdb_find_near(const geo_proj_t *pj, float radius_m, track_t *out) {
+    float best = radius_m * radius_m;
+    int hit = -1;
+    for (uint8_t k = 0; k < near_n; k++) {
+        geo_point_t p = geo_project(pj, near[k].lat_e7, near[k].lon_e7);
+        float d2 = p.x * p.x + p.y * p.y;
+        if (d2 <= best) { best = d2; hit = k; }
+    }
+    if (hit < 0) return false;
+    uint8_t rec[TDB_REC_SIZE];
+    FILE *db = fopen(db_path, "rb");
+    bool ok = db && tdb_read_rec(db, near[hit].idx, rec, 1);
+    if (db) fclose(db);
+    if (ok) tdb_decode(rec, out);
+    return ok;
+}
+
+bool track_db_find(int32_t lat_e7, int32_t lon_e7, float radius_m, track_t *out) {
+    if (!n_buckets) return false;
+    int32_t la, lo;
+    tdb_cell(lat_e7, lon_e7, &la, &lo);
+    geo_proj_t pj;
+    geo_proj_init(&pj, lat_e7, lon_e7);
+    uint32_t cell = tdb_interleave((uint32_t)la, (uint32_t)lo);
+    if (near_cell1 == cell + 1) return tdb_find_near(&pj, radius_m, out);
+
+    // A pista pode estar na célula vizinha se estivermos perto da borda
+    uint8_t rec[TDB_READ_RECS * TDB_REC_SIZE];
+    float best = radius_m * radius_m;
+    bool found = false, io_ok = true, fits = true;
+    FILE *db = NULL;                    // Aberto só se alguma célula tiver pista
+    near_cell1 = 0;
+    near_n = 0;
+    for (int dy = -1; dy <= 1; dy++) {
+        int32_t y = la + dy;
+        if (y < 0 || y >= (1 << TDB_LAT_BITS)) continue;
+        for (int dx = -1; dx <= 1; dx++) {
+            int32_t x = (lo + dx) & ((1 << TDB_LON_BITS) - 1);
+            const tdb_bucket_t *b = tdb_lookup(tdb_interleave((uint32_t)y, (uint32_t)x));
+            if (!b || !io_ok) continue;
+            if (!db && !(db = fopen(db_path, "rb"))) return false;
+            for (uint32_t i = 0; i < b->count; i += TDB_READ_RECS) {
+                uint32_t n = (b->count - i < TDB_READ_RECS) ? b->count - i : TDB_READ_RECS;
+                if (!tdb_read_rec(db, b->first + i, rec, n)) { io_ok = false; break; }
+                for (uint32_t k = 0; k < n; k++) {
+                    const uint8_t *r = rec + k * TDB_REC_SIZE;
+                    int32_t rlat = (int32_t)get_u32(r + 32), rlon = (int32_t)get_u32(r + 36);
+                    if (near_n < TDB_NEAR_MAX) near[near_n++] = (tdb_near_t){ rlat, rlon, b->first + i + k };
+                    else fits = false;
+                    geo_point_t p = geo_project(&pj, rlat, rlon);
+                    float d2 = p.x * p.x + p.y * p.y;
+                    if (d2 <= best) { best = d2; tdb_decode(r, out); found = true; }
+                }
+            }
+        }
+    }
+    if (db) fclose(db);
+    // Célula com pistas demais em volta fica sem cache (lê sempre)
+    if (io_ok && fits) near_cell1 = cell + 1;
+    return found;
+}
+
+static int tdb_cmp(const void *a, const void *b) {
+    uint32_t ka = get_u32((const uint8_t *)a + TDB_REC_KEY), kb = get_u32((const uint8_t *)b + TDB_REC_KEY);
+    return (ka > kb) - (ka < kb);
+}
+
+bool track_db_add(const track_t *t) {
+    if (!db_path[0]) return false;
+
+    // Carrega os registros atuais de uma vez e acrescenta o novo no fim
+    uint32_t n = n_tracks + 1;
+    uint8_t *recs = malloc((size_t)n * TDB_REC_SIZE);
+    if (!recs) return false;
+    if (n_tracks) {
+        FILE *db = fopen(db_path, "rb");
+        bool rd = db && fseek(db, (long)rec_off, SEEK_SET) == 0 && fread(recs, TDB_REC_SIZE, n_tracks, db) == n_tracks;
+        if (db) fclose(db);
+        if (!rd) { free(recs); return false; }
+    }
+    tdb_encode(recs + (size_t)(n - 1) * TDB_REC_SIZE, t);
+    qsort(recs, n, TDB_REC_SIZE, tdb_cmp);
+
+    // Tabela com pelo menos o dobro de slots que células: sondagens curtas
+    uint32_t cells = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (i == 0 || tdb_cmp(recs + i * TDB_REC_SIZE, recs + (i - 1) * TDB_REC_SIZE) != 0) cells++;
+    }
+    uint32_t nb = 16;
+    while (nb < cells * 2) nb <<= 1;
+    uint8_t *tbl = calloc(nb, TDB_BKT_SIZE);
+    if (!tbl) { free(recs); return false; }
+    uint8_t shift = tdb_shift_for(nb);
+    for (uint32_t i = 0; i < n;) {
+        uint32_t key = get_u32(recs + i * TDB_REC_SIZE + TDB_REC_KEY), j = i;
+        while (j < n && get_u32(recs + j * TDB_REC_SIZE + TDB_REC_KEY) == key) j++;
+        uint32_t s = (key * 2654435761u) >> shift;
+        while (get_u32(tbl + s * TDB_BKT_SIZE) != 0) s = (s + 1) & (nb - 1);
+        put_u32(tbl + s * TDB_BKT_SIZE, key + 1);
+        put_u32(tbl + s * TDB_BKT_SIZE + 4, i);
+        put_u32(tbl + s * TDB_BKT_SIZE + 8, j - i);
+        i = j;
+    }
+
+    uint8_t hdr[TDB_HDR_SIZE] = { 0 };
+    memcpy(hdr, TDB_MAGIC, 4);
+    put_u16(hdr + 4, TDB_VERSION);
+    put_u16(hdr + 6, TDB_REC_SIZE);
+    put_u32(hdr + 8, n);
+    put_u32(hdr + 12, nb);
+
+    // Grava num temporário e troca: um desligamento no meio não perde o banco
+    char tmp[72];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", db_path);
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f && fwrite(hdr, 1, TDB_HDR_SIZE, f) == TDB_HDR_SIZE &&
+              fwrite(tbl, TDB_BKT_SIZE, nb, f) == nb &&
+              fwrite(recs, TDB_REC_SIZE, n, f) == n;
+    if (f && fclose(f) != 0) ok = false;
+    free(tbl);
+    free(recs);
+    if (!ok) { remove(tmp); return false; }
+
+    // FAT não sobrescreve no rename: o banco antigo vira .bak até o novo
+    // estar no lugar (o track_db_open recupera o .bak de um corte no meio)
+    char bak[72];
+    snprintf(bak, sizeof(bak), "%s.bak", db_path);
+    track_db_close();
+    remove(bak);
+    FILE *old = fopen(db_path, "rb");
+    if (old) {
+        fclose(old);
+        if (rename(db_path, bak) != 0) { remove(tmp); track_db_open(db_path); return false; }
+    }
+    if (rename(tmp, db_path) != 0) { track_db_open(db_path); return false; }
+    remove(bak);
+    return track_db_open(db_path);
+}
@@ -0,0 +1,45 @@
+#ifndef TRACK_DB_H
+#define TRACK_DB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "track_geo.h"
+
+#define TRACK_NAME_LEN     32
+#define TRACK_MAX_SPLITS   8
+#define TRACK_GEOHASH_BITS 25   // Geohash de 5 caracteres: células de ~4,9 km
+
+// Portão gravado: parciais em cm no plano local com origem na linha
+typedef struct {
+    int32_t x_cm, y_cm;
+    uint16_t heading_cd;
+} track_split_t;
+
+typedef struct {
+    char name[TRACK_NAME_LEN];
+    int32_t lat_e7, lon_e7;     // Centro da linha de chegada
+    uint16_t heading_cd;        // Rumo de cruzamento da linha
+    uint8_t n_splits;
+    track_split_t splits[TRACK_MAX_SPLITS];
+} track_t;
+
+// Arquivo binário: cabeçalho de 32 bytes, tabela hash de células
+// (geohash -> faixa de registros) e registros de tamanho fixo ordenados
+// por célula. Na abertura só o cabeçalho e a tabela vão para a RAM; cada
+// busca custa no máximo 9 sondagens na tabela e uma leitura por célula.
+// As linhas em volta da última célula consultada ficam na RAM: enquanto o
+// kart não troca de célula, uma busca sem pista por perto não lê o cartão.
+bool track_db_open(const char *path);
+void track_db_close(void);
+uint32_t track_db_count(void);
+
+// Pista mais próxima com a linha a até 'radius_m' (menor que uma célula)
+bool track_db_find(int32_t lat_e7, int32_t lon_e7, float radius_m, track_t *out);
+
+// Acrescenta uma pista reescrevendo o arquivo (fim de sessão, na writer_task)
+bool track_db_add(const track_t *t);
+
+// Célula geohash (bits entrelaçados, longitude primeiro) de uma posição
+uint32_t track_geohash(int32_t lat_e7, int32_t lon_e7);
+
+#endif
@@ -0,0 +1,63 @@
+#include "track_geo.h"
+#include <math.h>
+
+#define DEG2RAD   0.017453292519943295
+#define WGS84_A   6378137.0
+#define WGS84_E2  6.69437999014e-3
+
+void geo_proj_init(geo_proj_t *p, int32_t lat_e7, int32_t lon_e7) {
+    double phi = lat_e7 * 1e-7 * DEG2RAD;
+    double s = sin(phi);
+    double w = 1.0 - WGS84_E2 * s * s;
+    double n = WGS84_A / sqrt(w);                     // Raio na primeira vertical
+    double m = WGS84_A * (1.0 - WGS84_E2) / (w * sqrt(w)); // Raio meridiano
+    p->lat0 = lat_e7;
+    p->lon0 = lon_e7;
+    p->m_per_e7_e = (float)(n * cos(phi) * DEG2RAD * 1e-7);
+    p->m_per_e7_n = (float)(m * DEG2RAD * 1e-7);
+}
+
+geo_point_t geo_project(const geo_proj_t *p, int32_t lat_e7, int32_t lon_e7) {
+    // Subtração inteira exata; a diferença já cabe sem perda num float
+    return (geo_point_t){ (float)(lon_e7 - p->lon0) * p->m_per_e7_e,
+                          (float)(lat_e7 - p->lat0) * p->m_per_e7_n };
+}
+
+void geo_unproject(const geo_proj_t *p, geo_point_t pt, int32_t *lat_e7, int32_t *lon_e7) {
+    *lat_e7 = p->lat0 + (int32_t)lroundf(pt.y / p->m_per_e7_n);
+    *lon_e7 = p->lon0 + (int32_t)lroundf(pt.x / p->m_per_e7_e);
+}
+
+void geo_gate_init(geo_gate_t *g, geo_point_t center, float heading_deg, float half_width_m) {
+    // Rumo GNSS: 0 = norte, 90 = leste
+    float h = (float)(heading_deg * DEG2RAD);
+    g->dir_x = sinf(h);
+    g->dir_y = cosf(h);
+    // Perpendicular ao rumo (direita do piloto)
+    float px = g->dir_y, py = -g->dir_x;
+    g->a = (geo_point_t){ center.x - px * half_width_m, center.y - py * half_width_m };
+    g->b = (geo_point_t){ center.x + px * half_width_m, center.y + py * half_width_m };
+}
+
+// Distância ao longo do rumo até a linha do portão (< 0 = antes dela)
+static float gate_side(const geo_gate_t *g, geo_point_t p) {
+    return (p.x - g->a.x) * g->dir_x + (p.y - g->a.y) * g->dir_y;
+}
+
+bool geo_gate_cross(const geo_gate_t *g, geo_point_t p0, geo_point_t p1, float *frac) {
+    // O lado de cada ponto sai da mesma conta nos dois trechos que o
+    // dividem: uma fix em cima da linha (ou a um arredondamento dela)
+    // conta uma vez só, no trecho que sai dela. Contramão ou parado nunca
+    // passa de "antes" para "depois".
+    float s0 = gate_side(g, p0), s1 = gate_side(g, p1);
+    if (!(s0 <= 0.0f && s1 > 0.0f)) return false;
+
+    float t = s0 / (s0 - s1); // Posição no trecho p0 -> p1, em [0, 1)
+    float sx = g->b.x - g->a.x, sy = g->b.y - g->a.y;
+    float cx = p0.x + t * (p1.x - p0.x) - g->a.x, cy = p0.y + t * (p1.y - p0.y) - g->a.y;
+    float u = (cx * sx + cy * sy) / (sx * sx + sy * sy); // Posição ao longo do portão
+    if (u < 0.0f || u > 1.0f) return false;
+
+    *frac = t;
+    return true;
+}
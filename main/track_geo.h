@@ -0,0 +1,36 @@
+#ifndef TRACK_GEO_H
+#define TRACK_GEO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Ponto no plano local da pista, em metros (x = leste, y = norte)
+typedef struct { float x, y; } geo_point_t;
+
+// Projeção plana local (ENU) em torno de uma origem fixa. Os fatores de
+// escala saem do elipsoide WGS84 uma única vez; depois cada fix custa só
+// duas subtrações e duas multiplicações. Erro < 1 cm num raio de 2 km.
+typedef struct {
+    int32_t lat0, lon0; // Origem (1e-7 grau)
+    float m_per_e7_e;   // Metros por 1e-7 grau de longitude na origem
+    float m_per_e7_n;   // Metros por 1e-7 grau de latitude na origem
+} geo_proj_t;
+
+void geo_proj_init(geo_proj_t *p, int32_t lat_e7, int32_t lon_e7);
+geo_point_t geo_project(const geo_proj_t *p, int32_t lat_e7, int32_t lon_e7);
+void geo_unproject(const geo_proj_t *p, geo_point_t pt, int32_t *lat_e7, int32_t *lon_e7);
+
+// Portão virtual: segmento centrado na linha marcada, perpendicular ao
+// rumo no momento da marcação. Só conta cruzamento no sentido do rumo.
+typedef struct {
+    geo_point_t a, b;   // Extremidades do segmento
+    float dir_x, dir_y; // Vetor unitário do rumo
+} geo_gate_t;
+
+void geo_gate_init(geo_gate_t *g, geo_point_t center, float heading_deg, float half_width_m);
+
+// Testa se o trecho p0 -> p1 cruza o portão no sentido do rumo.
+// Em caso positivo, 'frac' recebe a posição do cruzamento no trecho (0..1).
+bool geo_gate_cross(const geo_gate_t *g, geo_point_t p0, geo_point_t p1, float *frac);
+
+#endif
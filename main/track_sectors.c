@@ -0,0 +1,116 @@
+#include "track_sectors.h"
+#include <string.h>
+#include <math.h>
+
+static bool sector_cell(geo_point_t p, int *cx, int *cy) {
+    *cx = (int)floorf(p.x / SECTOR_GRID_CELL_M) + SECTOR_GRID_DIM / 2;
+    *cy = (int)floorf(p.y / SECTOR_GRID_CELL_M) + SECTOR_GRID_DIM / 2;
+    return *cx >= 0 && *cx < SECTOR_GRID_DIM && *cy >= 0 && *cy < SECTOR_GRID_DIM;
+}
+
+static void sector_lap_reset(sector_timer_t *s) {
+    s->next_gate = 0;
+    s->lap_ok = true;
+}
+
+void sector_init(sector_timer_t *s, uint8_t auto_count) {
+    memset(s, 0, sizeof(*s));
+    s->auto_count = (auto_count > SECTOR_MAX) ? SECTOR_MAX : auto_count;
+    sector_lap_reset(s);
+}
+
+bool sector_add_gate(sector_timer_t *s, geo_point_t center, float heading_deg, float half_width_m) {
+    if (s->n_gates >= SECTOR_MAX_GATES) return false;
+    uint8_t idx = s->n_gates++;
+    geo_gate_init(&s->gates[idx], center, heading_deg, half_width_m);
+
+    // Marca todas as células que a caixa do portão toca, com uma de folga
+    // para o trecho entre duas fixes que começa na célula vizinha
+    const geo_gate_t *g = &s->gates[idx];
+    int x0, y0, x1, y1;
+    bool in0 = sector_cell((geo_point_t){ fminf(g->a.x, g->b.x), fminf(g->a.y, g->b.y) }, &x0, &y0);
+    bool in1 = sector_cell((geo_point_t){ fmaxf(g->a.x, g->b.x), fmaxf(g->a.y, g->b.y) }, &x1, &y1);
+    if (!in0 || !in1) { s->outside_mask |= (uint16_t)(1u << idx); return true; }
+    for (int y = y0 - 1; y <= y1 + 1; y++) {
+        for (int x = x0 - 1; x <= x1 + 1; x++) {
+            if (x >= 0 && x < SECTOR_GRID_DIM && y >= 0 && y < SECTOR_GRID_DIM) s->grid[y][x] |= (uint16_t)(1u << idx);
+        }
+    }
+    return true;
+}
+
+bool sector_get_gate(const sector_timer_t *s, uint8_t idx, geo_point_t *center, float *heading_deg) {
+    if (idx >= s->n_gates) return false;
+    const geo_gate_t *g = &s->gates[idx];
+    *center = (geo_point_t){ (g->a.x + g->b.x) * 0.5f, (g->a.y + g->b.y) * 0.5f };
+    float h = atan2f(g->dir_x, g->dir_y) * 57.29578f;
+    *heading_deg = (h < 0.0f) ? h + 360.0f : h;
+    return true;
+}
+
+static void sector_commit(sector_timer_t *s, uint8_t i, uint32_t ms) {
+    s->last_ms[i] = ms;
+    if (s->best_ms[i] == 0 || ms < s->best_ms[i]) s->best_ms[i] = ms;
+}
+
+int sector_process(sector_timer_t *s, geo_point_t p0, geo_point_t p1, uint32_t t0_ms, uint32_t t1_ms) {
+    if (s->n_gates == 0) return -1;
+    int cx, cy;
+    uint16_t mask = s->outside_mask;
+    if (sector_cell(p1, &cx, &cy)) mask |= s->grid[cy][cx];
+    if (!mask) return -1;
+
+    for (uint8_t i = 0; i < s->n_gates; i++) {
+        float frac;
+        if (!(mask & (1u << i)) || i < s->next_gate) continue;
+        if (!geo_gate_cross(&s->gates[i], p0, p1, &frac)) continue;
+        // Pulou parcial (perda de sinal, atalho): setores desta volta não valem
+        if (i != s->next_gate) s->lap_ok = false;
+        s->split_ms[i] = t0_ms + (uint32_t)(frac * (float)(t1_ms - t0_ms) + 0.5f);
+        s->next_gate = i + 1;
+        // Melhor setor já entra na conta do ideal, sem esperar a volta fechar
+        if (s->lap_ok) sector_commit(s, i, s->split_ms[i] - (i ? s->split_ms[i - 1] : 0));
+        return i;
+    }
+    return -1;
+}
+
+void sector_auto_sample(sector_timer_t *s, geo_point_t p, float heading_deg, float dist_m) {
+    if (s->n_gates || s->auto_count < 2 || s->n_auto >= SECTOR_AUTO_PTS) return;
+    if (s->n_auto && dist_m - s->auto_pts[s->n_auto - 1].dist_m < SECTOR_AUTO_STEP_M) return;
+    s->auto_pts[s->n_auto++] = (sector_sample_t){ p, heading_deg, dist_m };
+}
+
+// Primeira volta completa sem parciais: divide em setores de mesma distância
+static void sector_auto_place(sector_timer_t *s, float lap_dist_m, float half_width_m) {
+    uint16_t j = 0;
+    for (uint8_t k = 1; k < s->auto_count; k++) {
+        float target = lap_dist_m * k / s->auto_count;
+        while (j + 1 < s->n_auto && s->auto_pts[j].dist_m < target) j++;
+        if (j >= s->n_auto) break;
+        sector_add_gate(s, s->auto_pts[j].p, s->auto_pts[j].heading, half_width_m);
+    }
+    s->n_auto = 0;
+}
+
+uint8_t sector_close_lap(sector_timer_t *s, uint32_t lap_ms, float lap_dist_m, float half_width_m, uint32_t *out) {
+    uint8_t n = 0;
+    if (s->n_gates && s->lap_ok && s->next_gate == s->n_gates) {
+        sector_commit(s, s->n_gates, lap_ms - s->split_ms[s->n_gates - 1]);
+        for (; n <= s->n_gates; n++) out[n] = s->last_ms[n];
+    } else if (!s->n_gates && s->auto_count >= 2 && s->n_auto) {
+        sector_auto_place(s, lap_dist_m, half_width_m);
+    }
+    sector_lap_reset(s);
+    return n;
+}
+
+uint32_t sector_theoretical_best(const sector_timer_t *s) {
+    if (!s->n_gates) return 0;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i <= s->n_gates; i++) {
+        if (s->best_ms[i] == 0) return 0;
+        sum += s->best_ms[i];
+    }
+    return sum;
+}
@@ -0,0 +1,62 @@
+#ifndef TRACK_SECTORS_H
+#define TRACK_SECTORS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "track_geo.h"
+
+#define SECTOR_MAX_GATES    8                      // Parciais além da linha de chegada
+#define SECTOR_MAX          (SECTOR_MAX_GATES + 1)
+#define SECTOR_GRID_DIM     64                     // Células por lado
+#define SECTOR_GRID_CELL_M  32.0f                  // Grade de 2 km centrada na linha
+#define SECTOR_AUTO_STEP_M  10.0f                  // Amostragem da 1a volta (auto)
+#define SECTOR_AUTO_PTS     512
+
+typedef struct { geo_point_t p; float heading; float dist_m; } sector_sample_t;
+
+// Parciais de uma pista. Cada célula da grade guarda a máscara dos
+// portões que passam por ela, então cada fix testa só os portões da
+// sua vizinhança, independente de quantos existam.
+typedef struct {
+    geo_gate_t gates[SECTOR_MAX_GATES];
+    uint8_t n_gates;
+    uint16_t grid[SECTOR_GRID_DIM][SECTOR_GRID_DIM];
+    uint16_t outside_mask;          // Portões fora da grade: sempre testados
+
+    // Volta atual
+    uint8_t next_gate;
+    bool lap_ok;                    // Todas as parciais vistas em ordem
+    uint32_t split_ms[SECTOR_MAX_GATES];
+
+    // Resultados
+    uint32_t last_ms[SECTOR_MAX];
+    uint32_t best_ms[SECTOR_MAX];
+
+    // Divisão automática em 'auto_count' setores iguais na 1a volta
+    uint8_t auto_count;
+    uint16_t n_auto;
+    sector_sample_t auto_pts[SECTOR_AUTO_PTS];
+} sector_timer_t;
+
+void sector_init(sector_timer_t *s, uint8_t auto_count);
+bool sector_add_gate(sector_timer_t *s, geo_point_t center, float heading_deg, float half_width_m);
+
+// Centro e rumo de um portão (para gravar a pista no banco)
+bool sector_get_gate(const sector_timer_t *s, uint8_t idx, geo_point_t *center, float *heading_deg);
+
+// Chamado a cada fix com o trecho percorrido e o tempo de volta (ms)
+// nas duas pontas. Retorna o índice da parcial cruzada ou -1.
+int sector_process(sector_timer_t *s, geo_point_t p0, geo_point_t p1, uint32_t t0_ms, uint32_t t1_ms);
+
+// Amostra para a divisão automática (só usada enquanto não há portões)
+void sector_auto_sample(sector_timer_t *s, geo_point_t p, float heading_deg, float dist_m);
+
+// Fecha a volta: calcula os setores, atualiza melhores e prepara a próxima.
+// Retorna quantos setores foram gravados em 'out' (0 se a volta não teve
+// todas as parciais).
+uint8_t sector_close_lap(sector_timer_t *s, uint32_t lap_ms, float lap_dist_m, float half_width_m, uint32_t *out);
+
+// Soma dos melhores setores (0 enquanto algum setor não tiver tempo)
+uint32_t sector_theoretical_best(const sector_timer_t *s);
+
+#endif
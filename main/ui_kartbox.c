@@ -7,6 +7,7 @@
 #include "usb_mode.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_system.h" // <--- NOVO INCLUDE PARA REINICIAR
 #include <stdio.h>
 #include <string.h>
@@ -23,7 +24,6 @@ LV_FONT_DECLARE(font_montserrat_80);
 // --- VARIÁVEIS E FUNÇÕES EXTERNAS ---
 extern bool recording_active;
 extern void end_race_session(void);
-extern int sd_get_session_string_list(char *buf, size_t max_len) __attribute__((weak));
 
 // --- PALETA DE CORES ---
 #define COLOR_BG        lv_color_hex(0x000000)
@@ -38,6 +38,7 @@ extern int sd_get_session_string_list(char *buf, size_t max_len) __attribute__((
 // --- OBJETOS GLOBAIS ---
 static lv_obj_t *tabview, *list_laps = NULL, *dd_sessions = NULL, *lbl_sd_storage = NULL;
 static lv_obj_t *lbl_speed, *lbl_lap_current, *lbl_lap_best, *lbl_lap_num, *lbl_gps_top, *lbl_mode, *lbl_race_name, *mode_border;
+static lv_obj_t *lbl_ideal, *lbl_hist_stats = NULL, *hist_spinner = NULL;
 static lv_obj_t *lbl_delta, *ui_reset_bar = NULL, *ui_chart = NULL, *lbl_chart_max_val = NULL;
 static lv_chart_series_t *ui_ser_speed = NULL;
 static uint32_t ui_best_ms = 0xFFFFFFFF;
@@ -77,25 +78,114 @@ static void delete_obj_timer_cb(lv_timer_t * t) {
     if (lv_obj_is_valid(obj)) lv_obj_delete(obj);
 }
 
+// --- CARREGAMENTO DO HISTÓRICO (TAREFA PRÓPRIA) ---
+// Os callbacks só pedem; a hist_task lê o SD e devolve tudo pronto numa
+// única chamada via lv_async_call. Cada pedido leva a geração da lista e
+// a das voltas: resultado de geração antiga (sessão trocada no meio da
+// leitura) é descartado.
+
+#define HIST_LIST 0x01  // Recarregar as opções do dropdown
+#define HIST_LAPS 0x02  // Carregar as voltas da sessão 'id'
+#define HIST_OPTS_LEN 4096
+#define HIST_MAX_SESSIONS 256
+
+typedef struct { uint8_t what; int32_t id; uint32_t list_gen, laps_gen; } hist_req_t; // id -1 = nenhuma
+typedef struct {
+    hist_req_t req;
+    char *options;      // NULL = lista vazia
+    uint16_t ids[HIST_MAX_SESSIONS];
+    int n_ids;
+    bool has_sum;
+    sd_summary_t sum;
+} hist_result_t;
+
+static QueueHandle_t hist_q = NULL;     // Caixa de um pedido: o novo absorve o pendente
+static volatile uint32_t hist_list_gen = 0, hist_laps_gen = 0;
+// Id de cada opção do dropdown: a lista cresce pelo topo quando uma sessão
+// começa, então a posição não identifica a sessão
+static uint16_t hist_ids[HIST_MAX_SESSIONS];
+static int hist_n_ids = 0;
+
+static int32_t hist_selected_id(void) {
+    int sel = (int)lv_dropdown_get_selected(dd_sessions);
+    return (sel < hist_n_ids) ? hist_ids[sel] : -1;
+}
+
+static void hist_free(hist_result_t *r) {
+    if (r->has_sum) sd_summary_free(&r->sum);
+    free(r->options);
+    free(r);
+}
+
+static void hist_apply_cb(void *arg) {
+    hist_result_t *r = (hist_result_t *)arg;
+    if ((r->req.what & HIST_LIST) && r->req.list_gen == hist_list_gen) {
+        // Mantém a mesma sessão escolhida, onde quer que ela tenha ido parar
+        int32_t id = hist_selected_id();
+        lv_dropdown_set_options(dd_sessions, r->options ? r->options : "Vazio");
+        memcpy(hist_ids, r->ids, sizeof(hist_ids));
+        hist_n_ids = r->options ? r->n_ids : 0;
+        for (int i = 0; i < hist_n_ids; i++) {
+            if (hist_ids[i] == id) { lv_dropdown_set_selected(dd_sessions, i); break; }
+        }
+    }
+    if ((r->req.what & HIST_LAPS) && r->req.laps_gen == hist_laps_gen) {
+        if (r->has_sum) ui_show_session_summary(&r->sum);
+        else ui_clear_lap_list();
+    }
+    // Nada mais novo a caminho
+    if (hist_spinner && r->req.list_gen == hist_list_gen && r->req.laps_gen == hist_laps_gen) {
+        lv_obj_add_flag(hist_spinner, LV_OBJ_FLAG_HIDDEN);
+    }
+    hist_free(r);
+}
+
+static void hist_task(void *arg) {
+    hist_req_t q;
+    while (1) {
+        if (xQueueReceive(hist_q, &q, portMAX_DELAY) != pdTRUE) continue;
+        hist_result_t *r = calloc(1, sizeof(hist_result_t));
+        if (!r) continue;
+        r->req = q;
+        if (q.what & HIST_LIST) {
+            r->options = malloc(HIST_OPTS_LEN);
+            if (r->options) r->n_ids = sd_get_session_string_list(r->options, HIST_OPTS_LEN, r->ids, HIST_MAX_SESSIONS);
+            if (r->options && r->n_ids == 0) { free(r->options); r->options = NULL; }
+        }
+        // Outra sessão escolhida enquanto a lista era lida: nem abre o resumo
+        if ((q.what & HIST_LAPS) && q.laps_gen == hist_laps_gen && q.id >= 0) r->has_sum = sd_read_session_summary((uint16_t)q.id, &r->sum);
+        if (lvgl_port_lock(0)) { lv_async_call(hist_apply_cb, r); lvgl_port_unlock(); }
+        else hist_free(r);
+    }
+}
+
+// Só do contexto do LVGL (callbacks ou com o lock)
+static void hist_request(uint8_t what, int32_t id) {
+    if (!hist_q) return;
+    hist_req_t q = { .what = what, .id = id }, pending;
+    // Pedido ainda na fila: junta (ex.: lista + voltas), as voltas valem as novas
+    if (xQueueReceive(hist_q, &pending, 0) == pdTRUE) {
+        q.what |= pending.what;
+        if (!(what & HIST_LAPS)) q.id = pending.id;
+    }
+    if (what & HIST_LIST) hist_list_gen++;
+    if (what & HIST_LAPS) { hist_laps_gen++; ui_clear_lap_list(); }
+    q.list_gen = hist_list_gen;
+    q.laps_gen = hist_laps_gen;
+    if (hist_spinner) lv_obj_remove_flag(hist_spinner, LV_OBJ_FLAG_HIDDEN);
+    xQueueSend(hist_q, &q, 0);
+}
+
 // --- CALLBACKS DE EVENTOS ---
 
 static void refresh_history_cb(lv_event_t * e) {
     if (ui_is_saving_task_running) return;
 
-    lv_obj_t * dropdown = (lv_obj_t *)lv_event_get_user_data(e);
-    uint16_t sel_idx = lv_dropdown_get_selected(dropdown);
-    
-    ui_clear_lap_list();
-    ui_show_popup("RECARREGANDO...", 500);
-    ui_refresh_session_dropdown();
-    sd_load_session_history(sel_idx);
+    hist_request(HIST_LIST | HIST_LAPS, hist_selected_id());
 }
 
 static void session_dropdown_cb(lv_event_t * e) {
-    lv_obj_t * dropdown = lv_event_get_target(e);
-    uint16_t sel_idx = lv_dropdown_get_selected(dropdown);
-    ui_clear_lap_list();
-    sd_load_session_history(sel_idx);
+    hist_request(HIST_LAPS, hist_selected_id());
 }
 
 // --- CALLBACK DO BOTÃO USB (MODIFICADO) ---
@@ -229,17 +319,23 @@ static void digital_btn_cb(lv_event_t * e) {
             press_start_tick = 0;
         }
     } 
-    else if(code == LV_EVENT_CLICKED) { // MODOS
-        if(type == 0) { 
-            gps_toggle_mode();
-            ui_show_mode_splash(gps_get_mode());
-        } else if(type == 1) {
+    else if(type == 1) { // MARCAR: toque marca a chegada, segurar marca uma parcial
+        if(code == LV_EVENT_SHORT_CLICKED) {
             if(gps_set_finish_line()) {
                 recording_active = true;
                 ui_show_popup("LINHA MARCADA", 1200);
             } else {
                 ui_show_popup("ERRO: SEM GPS", 1500);
             }
+        } else if(code == LV_EVENT_LONG_PRESSED) {
+            if(gps_add_split_gate()) ui_show_popup("PARCIAL MARCADA", 1200);
+            else ui_show_popup("ERRO: SEM LINHA", 1500);
+        }
+    }
+    else if(code == LV_EVENT_CLICKED) { // MODOS
+        if(type == 0) { 
+            gps_toggle_mode();
+            ui_show_mode_splash(gps_get_mode());
         }
     }
 }
@@ -330,6 +426,12 @@ void ui_init(void) {
     lv_obj_set_style_text_font(lbl_race_name, &lv_font_montserrat_18, 0);
     lv_obj_align(lbl_race_name, LV_ALIGN_TOP_LEFT, 25, 35);
 
+    lbl_ideal = lv_label_create(t1);
+    lv_obj_add_style(lbl_ideal, &style_text_white, 0);
+    lv_obj_set_style_text_font(lbl_ideal, &lv_font_montserrat_18, 0);
+    lv_obj_align(lbl_ideal, LV_ALIGN_TOP_LEFT, 25, 60);
+    lv_label_set_text(lbl_ideal, "IDEAL: --:--.---");
+
     lv_obj_t *btn_cont = lv_obj_create(t1);
     lv_obj_set_size(btn_cont, 800, 80);
     lv_obj_align(btn_cont, LV_ALIGN_BOTTOM_MID, 0, -5);
@@ -344,7 +446,7 @@ void ui_init(void) {
     for(int i=0; i<3; i++) {
         lv_obj_t *b = lv_button_create(btn_cont);
         lv_obj_set_size(b, 230, 60);
-        if(i == 2) lv_obj_add_event_cb(b, digital_btn_cb, LV_EVENT_ALL, (void*)(uintptr_t)i);
+        if(i >= 1) lv_obj_add_event_cb(b, digital_btn_cb, LV_EVENT_ALL, (void*)(uintptr_t)i);
         else lv_obj_add_event_cb(b, digital_btn_cb, LV_EVENT_CLICKED, (void*)(uintptr_t)i);
         lv_obj_set_style_bg_color(b, btn_colors[i], 0);
         lv_obj_t *l = lv_label_create(b);
@@ -383,6 +485,15 @@ void ui_init(void) {
     lv_obj_center(l_ref);
     lv_obj_set_style_text_color(l_ref, COLOR_TEXT, 0);
 
+    hist_spinner = lv_spinner_create(t2);
+    lv_obj_set_size(hist_spinner, 40, 40);
+    lv_obj_align_to(hist_spinner, btn_refresh, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+    lv_obj_set_style_arc_color(hist_spinner, COLOR_PRIMARY, LV_PART_INDICATOR);
+    lv_obj_add_flag(hist_spinner, LV_OBJ_FLAG_HIDDEN);
+
+    hist_q = xQueueCreate(1, sizeof(hist_req_t));
+    xTaskCreate(hist_task, "hist_task", 4096, NULL, 2, NULL);
+
     ui_chart = lv_chart_create(t2);
     lv_obj_set_size(ui_chart, 360, 140);
     lv_obj_align(ui_chart, LV_ALIGN_TOP_RIGHT, -50, 10);
@@ -404,6 +515,11 @@ void ui_init(void) {
     lv_obj_t *lu = lv_label_create(t2); lv_label_set_text(lu, "KM/H");
     lv_obj_add_style(lu, &style_text_white, 0); lv_obj_align_to(lu, ui_chart, LV_ALIGN_OUT_LEFT_BOTTOM, -5, 0);
 
+    lbl_hist_stats = lv_label_create(t2);
+    lv_obj_add_style(lbl_hist_stats, &style_text_white, 0);
+    lv_obj_align(lbl_hist_stats, LV_ALIGN_TOP_LEFT, 20, 70);
+    lv_label_set_text(lbl_hist_stats, "");
+
     list_laps = lv_list_create(t2);
     lv_obj_set_size(list_laps, 760, 200);
     lv_obj_align(list_laps, LV_ALIGN_BOTTOM_MID, 0, -10);
@@ -442,6 +558,13 @@ void ui_update(gps_data_t gps, mpu_data_t mpu, uint32_t cur_time, uint32_t last_
 
     static char buf[64];
 
+    // Sessão aberta (auto-arm, linha marcada) ou fechada fora da UI
+    static uint32_t sessions_gen = 0;
+    if (sd_get_sessions_gen() != sessions_gen) {
+        sessions_gen = sd_get_sessions_gen();
+        ui_refresh_session_dropdown();
+    }
+
     // 1. Diagnóstico de Hardware (Heartbeat)
     bool hardware_ok = false;
     
@@ -455,7 +578,7 @@ void ui_update(gps_data_t gps, mpu_data_t mpu, uint32_t cur_time, uint32_t last_
         }
     }
 
-    snprintf(buf, sizeof(buf), "%d KM/H", (int)gps.speed_kmh); lv_label_set_text(lbl_speed, buf);
+    snprintf(buf, sizeof(buf), "%d KM/H", (int)gps_speed_kmh(&gps)); lv_label_set_text(lbl_speed, buf);
     snprintf(buf, sizeof(buf), "VOLTA %u", laps); lv_label_set_text(lbl_lap_num, buf);
     format_time(buf, sizeof(buf), cur_time); lv_label_set_text(lbl_lap_current, buf);
     
@@ -490,6 +613,16 @@ void ui_update(gps_data_t gps, mpu_data_t mpu, uint32_t cur_time, uint32_t last_
 
     snprintf(buf, sizeof(buf), "CORRIDA %u", race_id);
     lv_label_set_text(lbl_race_name, buf);
+
+    // Volta ideal (soma dos melhores setores)
+    uint32_t ideal = gps_get_theoretical_best();
+    if (ideal > 0) {
+        char t_buf[16]; format_time(t_buf, 16, ideal);
+        snprintf(buf, sizeof(buf), "IDEAL: %s", t_buf);
+    } else {
+        snprintf(buf, sizeof(buf), "IDEAL: --:--.---");
+    }
+    lv_label_set_text(lbl_ideal, buf);
 }
 
 void ui_add_point_to_chart(float speed) {
@@ -520,9 +653,57 @@ void ui_clear_lap_list(void) {
         lv_chart_set_div_line_count(ui_chart, 5, 1);
         if (lbl_chart_max_val) lv_label_set_text(lbl_chart_max_val, "40");
     }
+    if (lbl_hist_stats) lv_label_set_text(lbl_hist_stats, "");
     ui_best_ms = 0xFFFFFFFF; 
 }
 
+void ui_show_session_summary(const sd_summary_t *sum) {
+    const sd_summary_hdr_t *h = &sum->hdr;
+    ui_clear_lap_list();
+
+    if (lbl_hist_stats) {
+        char b[160], t_best[16], t_ideal[16], t_mean[16];
+        format_time(t_best, 16, h->best_ms);
+        format_time(t_ideal, 16, h->ideal_ms);
+        format_time(t_mean, 16, h->mean_ms);
+        if (h->n_laps == 0) snprintf(b, sizeof(b), "SEM VOLTAS");
+        else snprintf(b, sizeof(b), "MELHOR: %s (V%u)\nIDEAL: %s\nMEDIA: %s +/- %lu.%03lus (%u voltas)",
+                      t_best, h->best_lap, h->ideal_ms ? t_ideal : "--:--.---",
+                      t_mean, h->stdev_ms / 1000, h->stdev_ms % 1000, h->n_consistent);
+        lv_label_set_text(lbl_hist_stats, b);
+    }
+
+    // Gráfico: todos os pontos e a escala de uma vez, um só refresh
+    if (ui_chart && ui_ser_speed && h->n_laps) {
+        uint16_t top = 0;
+        for (uint16_t i = 0; i < h->n_laps; i++) if (sum->laps[i].avg_kmh10 > top) top = sum->laps[i].avg_kmh10;
+        if (top / 10.0f > ui_session_max_speed) ui_session_max_speed = top / 10.0f + 10.0f;
+        lv_chart_set_point_count(ui_chart, h->n_laps);
+        for (uint16_t i = 0; i < h->n_laps; i++) {
+            lv_chart_set_value_by_id(ui_chart, ui_ser_speed, i, sum->laps[i].avg_kmh10 / 10);
+        }
+        ui_total_laps_in_chart = h->n_laps;
+        lv_chart_set_range(ui_chart, LV_CHART_AXIS_PRIMARY_Y, 0, (int32_t)ui_session_max_speed);
+        lv_chart_set_div_line_count(ui_chart, 5, h->n_laps);
+        if (lbl_chart_max_val) {
+            char b[16]; snprintf(b, 16, "%d", (int)ui_session_max_speed);
+            lv_label_set_text(lbl_chart_max_val, b);
+        }
+        lv_chart_refresh(ui_chart);
+    }
+
+    if (!list_laps) return;
+    for (uint16_t i = 0; i < h->n_laps; i++) {
+        const sd_lap_summary_t *l = &sum->laps[i];
+        char b[128], t[16]; format_time(t, 16, l->ms);
+        if (l->max_kmh10) snprintf(b, sizeof(b), "Volta %u: %s   %u.%u / %u.%u km/h", i + 1, t,
+                                   l->avg_kmh10 / 10, l->avg_kmh10 % 10, l->max_kmh10 / 10, l->max_kmh10 % 10);
+        else snprintf(b, sizeof(b), "Volta %u: %s   %u.%u km/h", i + 1, t, l->avg_kmh10 / 10, l->avg_kmh10 % 10);
+        lv_obj_t *btn = lv_list_add_button(list_laps, (i + 1 == h->best_lap) ? LV_SYMBOL_OK : LV_SYMBOL_PLAY, b);
+        lv_obj_add_style(btn, &style_list_btn, 0);
+    }
+}
+
 void ui_update_reset_progress(uint32_t progress) {
     if(ui_reset_bar == NULL) {
         ui_reset_bar = lv_bar_create(lv_layer_top());
@@ -548,28 +729,7 @@ void ui_add_lap_to_list(uint16_t num, uint32_t ms) {
 
 void ui_refresh_session_dropdown(void) {
     if (!dd_sessions) return;
-    
-    if (sd_get_session_string_list) {
-        char *buf = malloc(4096); 
-        if (buf) {
-            if (sd_get_session_string_list(buf, 4096) > 0) {
-                lv_dropdown_set_options(dd_sessions, buf);
-            } else {
-                lv_dropdown_set_options(dd_sessions, "Vazio");
-            }
-            free(buf);
-            return;
-        }
-    }
-
-    uint16_t sessions[50]; int count = sd_get_available_sessions(sessions, 50);
-    if (count == 0) { lv_dropdown_set_options(dd_sessions, "Vazio"); return; }
-    char *buf = malloc(4096); buf[0] = '\0';
-    for (int i = 0; i < count; i++) { 
-        char t[64]; snprintf(t, 64, "SESSION_%03d.LOG\n", sessions[i]); strcat(buf, t);
-    }
-    lv_dropdown_set_options(dd_sessions, buf);
-    free(buf);
+    hist_request(HIST_LIST, -1);
 }
 
 void ui_update_sd_info(void) {
@@ -3,6 +3,7 @@
 
 #include "telemetry_gps.h"
 #include "telemetry_mpu.h"
+#include "sd_summary.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -17,6 +18,8 @@ void ui_add_lap_to_list(uint16_t lap_num, uint32_t time_ms);
 void ui_clear_lap_list(void);
 void ui_refresh_session_dropdown(void);
 void ui_add_point_to_chart(float speed);
+// Preenche a aba VOLTAS de uma vez (lista, gráfico e estatísticas)
+void ui_show_session_summary(const sd_summary_t *sum);
 void ui_update_reset_progress(uint32_t progress);
 void ui_hide_reset_progress(void);
 
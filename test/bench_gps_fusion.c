@@ -0,0 +1,72 @@
+// Replay de uma sessão com IMU e GNSS pela fusão, como no firmware: cada
+// amostra da IMU é um passo, cada fix entra com o instante de medida
+// recuado da latência. Cronometra todas as voltas pelas fixes a 10 Hz
+// (só GPS) e pela saída da fusão a 100 Hz, compara com as passagens
+// reais e mede o custo de cada passo. Outra sessão no mesmo formato:
+// bench_gps_fusion <arquivo> (relativo a test/fixtures).
+#include "replay_util.h"
+#include "bench_util.h"
+
+#define LATENCY_MS 50           // GPS_FUSION_LATENCY_MS do config.h
+
+static double lap_err(const double *cross, int k, const replay_t *r) {
+    return (cross[k + 1] - cross[k]) - (r->truth_ms[k + 1] - r->truth_ms[k]);
+}
+
+int main(int argc, char **argv) {
+    const char *name = argc > 1 ? argv[1] : "sessao_oval_imu.txt";
+    replay_t r;
+    if (!replay_load(&r, name)) { fprintf(stderr, "sem sessão em %s\n", name); return 1; }
+
+    geo_proj_t pj;
+    geo_proj_init(&pj, r.line_lat, r.line_lon);
+    replay_timer_t gps_only, fused;
+    replay_timer_init(&gps_only, &pj, &r);
+    replay_timer_init(&fused, &pj, &r);
+
+    static gps_fusion_t f;
+    gps_fusion_reset(&f);
+    gps_data_t out;
+    uint64_t ns = 0, worst = 0;
+    long steps = 0;
+    for (int i = 0; i < r.n_ev; i++) {
+        const replay_ev_t *e = &r.ev[i];
+        uint64_t t0 = bench_ns();
+        if (e->kind == 'G') {
+            gps_fusion_fix(&f, &e->fix, (e->t_ms - LATENCY_MS) * 1000u);
+        } else {
+            gps_fusion_imu(&f, e->t_ms * 1000u, e->a_g, e->w_dps);
+        }
+        bool ok = gps_fusion_output(&f, &out);
+        uint64_t dt = bench_ns() - t0;
+        ns += dt;
+        if (dt > worst) worst = dt;
+        steps++;
+        if (e->kind == 'G') replay_timer_feed(&gps_only, &e->fix);
+        else if (ok) replay_timer_feed(&fused, &out);
+    }
+
+    printf("%s: %d passagens reais, %ld passos (IMU + fixes)\n", name, r.n_truth, steps);
+    printf("fusão: %.2f us por passo (pior %.1f us)\n", ns * 1e-3 / steps, worst * 1e-3);
+    if (gps_only.n_cross != r.n_truth || fused.n_cross != r.n_truth) {
+        printf("passagens detectadas: só GPS %d, fusão %d (esperado %d)\n", gps_only.n_cross, fused.n_cross, r.n_truth);
+        replay_free(&r);
+        return 1;
+    }
+
+    printf("volta      real ms   só GPS (erro)    fusão (erro)\n");
+    double sum_g = 0, sum_f = 0;
+    int laps = r.n_truth - 1;
+    for (int k = 0; k < laps; k++) {
+        double eg = lap_err(gps_only.cross_ms, k, &r), ef = lap_err(fused.cross_ms, k, &r);
+        printf("%5d %12.1f %9.1f (%+5.1f) %9.1f (%+5.1f)\n", k + 1, r.truth_ms[k + 1] - r.truth_ms[k],
+               gps_only.cross_ms[k + 1] - gps_only.cross_ms[k], eg,
+               fused.cross_ms[k + 1] - fused.cross_ms[k], ef);
+        sum_g += fabs(eg);
+        sum_f += fabs(ef);
+    }
+    printf("erro médio da volta: só GPS %.1f ms, fusão %.1f ms (diferença %+.1f ms)\n",
+           sum_g / laps, sum_f / laps, (sum_f - sum_g) / laps);
+    replay_free(&r);
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Codec de blocos do log sobre a sessão gravada sessao_7.kbl: taxa de
+// compressão dos blocos do arquivo e velocidade de encode/decode dos
+// mesmos registros, repetidos.
+#include "test_util.h"
+#include "bench_util.h"
+#include "log_codec.h"
+#include "log_format.h"
+
+#define REPS     200000
+#define MAX_BLKS 8
+#define BLK_RECS 25
+
+static void report(const char *name, uint64_t ns, uint64_t cyc, long recs) {
+    double raw = (double)recs * LOG_REC_SIZE;
+    printf("%-7s %8.1f MB/s brutos  %6.1f ns/registro", name, raw * 1e3 / ns, (double)ns / recs);
+    if (cyc) printf("  %6.0f ciclos/registro", (double)cyc / recs);
+    printf("\n");
+}
+
+int main(void) {
+    static uint8_t file[4096];
+    FILE *f = test_fixture("sessao_7.kbl");
+    size_t file_len = fread(file, 1, sizeof(file), f);
+    fclose(f);
+
+    log_codec_t codec;
+    uint8_t widths[LOG_CODEC_MAX_FIELDS];
+    if (!log_codec_init(&codec, widths, log_field_widths(widths))) return 1;
+
+    // Blocos íntegros do arquivo (o 4o, cortado, fica de fora)
+    static uint8_t recs[MAX_BLKS][BLK_RECS * LOG_REC_SIZE], enc[1024];
+    uint16_t n[MAX_BLKS];
+    size_t off[MAX_BLKS], used, pos = LOG_HDR_SIZE, coded = 0;
+    int blks = 0, total = 0, r;
+    while (blks < MAX_BLKS &&
+           (r = log_block_decode(&codec, file + pos, file_len - pos, recs[blks], BLK_RECS, &used)) >= 0) {
+        n[blks] = (uint16_t)r;
+        off[blks++] = pos;
+        total += r;
+        coded += used;
+        pos += used;
+    }
+    if (!blks) return 1;
+
+    uint64_t t0 = bench_ns(), c0 = bench_cycles();
+    for (int k = 0; k < REPS; k++)
+        for (int b = 0; b < blks; b++) BENCH_KEEP(log_block_encode(&codec, recs[b], n[b], enc, sizeof(enc)));
+    uint64_t c_enc = bench_cycles() - c0, t_enc = bench_ns() - t0;
+
+    t0 = bench_ns(); c0 = bench_cycles();
+    for (int k = 0; k < REPS; k++)
+        for (int b = 0; b < blks; b++)
+            BENCH_KEEP(log_block_decode(&codec, file + off[b], file_len - off[b], recs[b], BLK_RECS, NULL));
+    uint64_t c_dec = bench_cycles() - c0, t_dec = bench_ns() - t0;
+
+    size_t raw = (size_t)total * LOG_REC_SIZE;
+    printf("%d blocos, %d registros: %zu bytes brutos -> %zu comprimidos (%.1f%%, %.2f:1)\n",
+           blks, total, raw, coded, 100.0 * coded / raw, (double)raw / coded);
+    long reps = (long)total * REPS;
+    report("encode", t_enc, c_enc, reps);
+    report("decode", t_dec, c_dec, reps);
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Parser NMEA novo (gps_nmea.c, byte a byte, sem heap) contra o antigo
+// (linha inteira + strdup/strtok_r/atof, como estava no telemetry_gps.c),
+// os dois sobre a captura interlagos_10hz.nmea repetida.
+#include "test_util.h"
+#include "bench_util.h"
+#include "gps_nmea.h"
+
+#define REPS 20000
+
+// --- Parser antigo (copiado da base, só com os campos num struct local) ---
+typedef struct {
+    float lat, lon, speed_kmh, course;
+    int sats;
+    bool valid;
+    uint8_t day, month, year, hour, minute, second;
+} legacy_gps_t;
+
+static legacy_gps_t legacy;
+static char line_buffer[1024];
+static int line_pos;
+
+static void legacy_parse_nmea(const char *s) {
+    if (strstr(s, "GGA")) {
+        char *p = strdup(s), *tok, *save; int f = 0;
+        for (tok = strtok_r(p, ",", &save); tok; tok = strtok_r(NULL, ",", &save), f++) {
+            if (f == 2 && strlen(tok) > 0) { float raw = atof(tok); float deg = (int)(raw/100); legacy.lat = deg + (raw-deg*100)/60.0f; }
+            else if (f == 3 && tok[0] == 'S') legacy.lat *= -1;
+            else if (f == 4 && strlen(tok) > 0) { float raw = atof(tok); float deg = (int)(raw/100); legacy.lon = deg + (raw-deg*100)/60.0f; }
+            else if (f == 5 && tok[0] == 'W') legacy.lon *= -1;
+            else if (f == 6) legacy.valid = (tok[0] != '0');
+            else if (f == 7) legacy.sats = atoi(tok);
+        }
+        free(p);
+    } else if (strstr(s, "RMC")) {
+        char *p = strdup(s), *tok, *save; int f = 0;
+        for (tok = strtok_r(p, ",", &save); tok; tok = strtok_r(NULL, ",", &save), f++) {
+            if (f == 1 && strlen(tok) >= 6) {
+                int h = (tok[0]-'0')*10 + (tok[1]-'0');
+                h = (h < 3) ? h + 21 : h - 3;
+                legacy.hour = h;
+                legacy.minute = (tok[2]-'0')*10 + (tok[3]-'0');
+                legacy.second = (tok[4]-'0')*10 + (tok[5]-'0');
+            }
+            else if (f == 2) legacy.valid = (tok[0] == 'A');
+            else if (f == 7 && strlen(tok) > 0) legacy.speed_kmh = atof(tok) * 1.852f;
+            else if (f == 8 && strlen(tok) > 0) legacy.course = atof(tok);
+            else if (f == 9 && strlen(tok) >= 6) {
+                legacy.day = (tok[0]-'0')*10 + (tok[1]-'0');
+                legacy.month = (tok[2]-'0')*10 + (tok[3]-'0');
+                legacy.year = (tok[4]-'0')*10 + (tok[5]-'0');
+            }
+        }
+        free(p);
+    }
+}
+
+static void legacy_feed(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == '\n') { line_buffer[line_pos] = '\0'; legacy_parse_nmea(line_buffer); line_pos = 0; }
+        else if (line_pos < 1023) line_buffer[line_pos++] = buf[i];
+    }
+}
+
+static void report(const char *name, uint64_t ns, uint64_t cyc, long sentences) {
+    printf("%-22s %10.0f sentenças/s  %8.0f ns/sentença", name, sentences * 1e9 / ns, (double)ns / sentences);
+    if (cyc) printf("  %8.0f ciclos/sentença", (double)cyc / sentences);
+    printf("\n");
+}
+
+int main(void) {
+    static uint8_t cap[4096];
+    FILE *f = test_fixture("interlagos_10hz.nmea");
+    size_t len = fread(cap, 1, sizeof(cap), f);
+    fclose(f);
+    long per_pass = 0;
+    for (size_t i = 0; i < len; i++) per_pass += cap[i] == '\n';
+    long sentences = per_pass * REPS;
+
+    nmea_parser_t p;
+    gps_data_t gps = {0};
+    nmea_parser_init(&p);
+    uint64_t t0 = bench_ns(), c0 = bench_cycles();
+    for (int r = 0; r < REPS; r++)
+        for (size_t i = 0; i < len; i++) nmea_parser_feed(&p, cap[i], &gps);
+    uint64_t c_new = bench_cycles() - c0, t_new = bench_ns() - t0;
+    BENCH_KEEP(gps.lat_e7);
+
+    t0 = bench_ns(); c0 = bench_cycles();
+    for (int r = 0; r < REPS; r++) legacy_feed(cap, len);
+    uint64_t c_old = bench_cycles() - c0, t_old = bench_ns() - t0;
+    BENCH_KEEP(legacy.lat);
+
+    printf("%ld sentenças (%zu bytes x %d)\n", sentences, len, REPS);
+    report("gps_nmea (novo)", t_new, c_new, sentences);
+    report("strdup/strtok (antigo)", t_old, c_old, sentences);
+    printf("novo / antigo: %.1fx mais rápido\n", (double)t_old / t_new);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Relógio de parede em ns e, no x86, o contador de ciclos (TSC). Fora do
+// x86 os ciclos ficam em 0 e só o tempo vale.
+static inline uint64_t bench_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t bench_cycles(void) { return __rdtsc(); }
+#else
+static inline uint64_t bench_cycles(void) { return 0; }
+#endif
+
+// Impede o compilador de descartar um resultado que ninguém lê
+#define BENCH_KEEP(v) __asm__ volatile("" : : "g"(v) : "memory")
+
+#endif
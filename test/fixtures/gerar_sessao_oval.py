@@ -0,0 +1,118 @@
+import math
+import os
+import random
+
+# =================================================================
+# GERA sessao_oval_imu.txt: sessão de 3 voltas num oval (duas retas de
+# 120 m, curvas de 25 m de raio à esquerda) com o que o KartBox recebe:
+# IMU a 100 Hz (aceleração longitudinal com bias, guinada com bias) e
+# fixes a 10 Hz com erro de posição lento + ruído, chegando ~50 ms
+# depois da medida. Traz também a linha e os instantes reais de cada
+# passagem, para o replay medir o erro do cronômetro.
+#
+# Linhas (tempo local em ms, o mesmo relógio do timestamp_ms):
+#   F lat_e7 lon_e7 rumo_graus            linha de chegada
+#   G chegada_ms gnss_ms lat_e7 lon_e7 vel_mm_s rumo_cd
+#   I t_ms acel_long_g guinada_graus_s    (+ = esquerda)
+#   L gnss_ms                             passagem real pela linha
+# =================================================================
+
+RETA, RAIO = 120.0, 25.0
+V_CURVA, V_RETA = 14.0, 26.0
+VOLTAS, DURACAO_MS = 3, 80000
+GNSS_T0_MS = 55812000          # 15:30:12 UTC
+LAT0, LON0 = -237020575, -466923868
+BIAS_A, BIAS_G = 0.15, 0.6     # m/s², °/s
+G0 = 9.80665
+
+rng = random.Random(7)
+P = 2 * RETA + 2 * math.pi * RAIO
+
+
+def escala():
+    # Mesmos fatores do geo_proj_init (track_geo.c)
+    phi = math.radians(LAT0 * 1e-7)
+    w = 1.0 - 6.69437999014e-3 * math.sin(phi) ** 2
+    n = 6378137.0 / math.sqrt(w)
+    m = 6378137.0 * (1.0 - 6.69437999014e-3) / (w * math.sqrt(w))
+    return n * math.cos(phi) * math.radians(1e-7), m * math.radians(1e-7)
+
+
+M_E, M_N = escala()
+
+
+def para_e7(x, y):
+    return LAT0 + round(y / M_N), LON0 + round(x / M_E)
+
+
+def ponto(s):
+    """Posição (m), rumo (graus) e curvatura (1/m, + = esquerda) em s."""
+    s %= P
+    if s < RETA:
+        return s, 0.0, 90.0, 0.0
+    s -= RETA
+    if s < math.pi * RAIO:
+        f = s / RAIO
+        return RETA + RAIO * math.sin(f), RAIO - RAIO * math.cos(f), 90.0 - math.degrees(f), 1.0 / RAIO
+    s -= math.pi * RAIO
+    if s < RETA:
+        return RETA - s, 2 * RAIO, 270.0, 0.0
+    f = (s - RETA) / RAIO
+    return -RAIO * math.sin(f), RAIO + RAIO * math.cos(f), 270.0 - math.degrees(f), 1.0 / RAIO
+
+
+def velocidade(s):
+    """Velocidade (m/s) e dv/ds: sobe e desce suave em cada reta."""
+    s %= P
+    for ini in (0.0, RETA + math.pi * RAIO):
+        if ini <= s < ini + RETA:
+            u = (s - ini) / RETA
+            d = V_RETA - V_CURVA
+            return V_CURVA + d * math.sin(math.pi * u) ** 2, d * math.pi / RETA * math.sin(2 * math.pi * u)
+    return V_CURVA, 0.0
+
+
+def main():
+    linha_s = RETA / 2
+    eventos = []
+    lx, ly = para_e7(linha_s, 0.0)
+    cab = ["# Gerado por gerar_sessao_oval.py (não editar à mão)\n", f"F {lx} {ly} 90.0\n"]
+
+    s, t_ms = linha_s - 90.0, 0  # Começa na última curva, 90 m antes da linha
+    ex = ey = 0.0                # Erro lento do GNSS (Gauss-Markov, tau 5 s)
+    voltas = 0
+    while t_ms <= DURACAO_MS:
+        v, dvds = velocidade(s)
+        x, y, rumo, k = ponto(s)
+        if t_ms % 10 == 0:
+            a = v * dvds + BIAS_A + 0.2 * rng.gauss(0, 1)
+            w = math.degrees(v * k) + BIAS_G + 0.3 * rng.gauss(0, 1)
+            eventos.append((t_ms, 1, f"I {t_ms} {a / G0:.4f} {w:.3f}\n"))
+        if t_ms % 100 == 0:
+            ex += -ex / 50 + 0.06 * rng.gauss(0, 1)
+            ey += -ey / 50 + 0.06 * rng.gauss(0, 1)
+            lat, lon = para_e7(x + ex + 0.15 * rng.gauss(0, 1), y + ey + 0.15 * rng.gauss(0, 1))
+            vel = round((v + 0.05 * rng.gauss(0, 1)) * 1000)
+            crs = round(((rumo + 0.3 * rng.gauss(0, 1)) % 360.0) * 100) % 36000
+            chegada = t_ms + 50 + rng.randint(0, 8)
+            eventos.append((chegada, 0, f"G {chegada} {GNSS_T0_MS + t_ms} {lat} {lon} {vel} {crs}\n"))
+
+        # 1 ms por passo; a passagem real é interpolada dentro do passo
+        s_prox = s + v * 1e-3
+        volta_s = linha_s + voltas * P
+        if s < volta_s <= s_prox and voltas <= VOLTAS:
+            frac = (volta_s - s) / (s_prox - s)
+            cab.append(f"L {GNSS_T0_MS + t_ms + frac:.3f}\n")
+            voltas += 1
+        s = s_prox
+        t_ms += 1
+
+    eventos.sort(key=lambda e: (e[0], e[1]))
+    saida = os.path.join(os.path.dirname(os.path.abspath(__file__)), "sessao_oval_imu.txt")
+    with open(saida, "w", newline="\n") as f:
+        f.writelines(cab)
+        f.writelines(e[2] for e in eventos)
+
+
+if __name__ == "__main__":
+    main()
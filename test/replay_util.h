@@ -0,0 +1,97 @@
+#ifndef REPLAY_UTIL_H
+#define REPLAY_UTIL_H
+
+// Replay de uma sessão gravada no formato do gerar_sessao_oval.py: linha
+// de chegada, fixes (com instante de chegada), IMU a 100 Hz e as
+// passagens reais pela linha. Mais um cronômetro mínimo, o mesmo cálculo
+// do gps_process_timing: cruzamento do portão interpolado no gnss_ms.
+#include "test_util.h"
+#include "gps_fusion.h"
+
+#define REPLAY_MAX_LAPS 16
+
+typedef struct {
+    char kind;                  // 'G' fix, 'I' IMU
+    uint32_t t_ms;              // Chegada (fix) ou instante da amostra (IMU)
+    gps_data_t fix;
+    float a_g, w_dps;
+} replay_ev_t;
+
+typedef struct {
+    int32_t line_lat, line_lon;
+    float line_heading;
+    double truth_ms[REPLAY_MAX_LAPS];   // Passagens reais (gnss_ms)
+    int n_truth;
+    replay_ev_t *ev;
+    int n_ev;
+} replay_t;
+
+static inline bool replay_load(replay_t *r, const char *name) {
+    memset(r, 0, sizeof(*r));
+    FILE *f = test_fixture(name);
+    char line[128];
+    int cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        replay_ev_t e = { .kind = line[0] };
+        if (line[0] == 'F') {
+            sscanf(line + 1, "%d %d %f", &r->line_lat, &r->line_lon, &r->line_heading);
+            continue;
+        }
+        if (line[0] == 'L') {
+            if (r->n_truth < REPLAY_MAX_LAPS) sscanf(line + 1, "%lf", &r->truth_ms[r->n_truth++]);
+            continue;
+        }
+        if (line[0] == 'G') {
+            unsigned crs;
+            if (sscanf(line + 1, "%u %u %d %d %d %u", &e.t_ms, &e.fix.gnss_ms, &e.fix.lat_e7, &e.fix.lon_e7,
+                       &e.fix.speed_mms, &crs) != 6) continue;
+            e.fix.course_cd = (uint16_t)crs;
+            e.fix.timestamp_ms = e.t_ms;
+            e.fix.valid = true;
+            e.fix.sats = 12;
+        } else if (line[0] == 'I') {
+            if (sscanf(line + 1, "%u %f %f", &e.t_ms, &e.a_g, &e.w_dps) != 3) continue;
+        } else {
+            continue;
+        }
+        if (r->n_ev == cap) {
+            cap = cap ? cap * 2 : 4096;
+            r->ev = realloc(r->ev, (size_t)cap * sizeof(replay_ev_t));
+        }
+        r->ev[r->n_ev++] = e;
+    }
+    fclose(f);
+    return r->n_ev > 0;
+}
+
+static inline void replay_free(replay_t *r) { free(r->ev); r->ev = NULL; }
+
+typedef struct {
+    const geo_proj_t *pj;
+    geo_gate_t gate;
+    bool has_prev;
+    geo_point_t prev;
+    uint32_t prev_gnss_ms;
+    double cross_ms[REPLAY_MAX_LAPS];
+    int n_cross;
+} replay_timer_t;
+
+static inline void replay_timer_init(replay_timer_t *t, const geo_proj_t *pj, const replay_t *r) {
+    memset(t, 0, sizeof(*t));
+    t->pj = pj;
+    geo_gate_init(&t->gate, geo_project(pj, r->line_lat, r->line_lon), r->line_heading, 8.0f);
+}
+
+static inline void replay_timer_feed(replay_timer_t *t, const gps_data_t *d) {
+    geo_point_t p = geo_project(t->pj, d->lat_e7, d->lon_e7);
+    float frac;
+    if (t->has_prev && geo_gate_cross(&t->gate, t->prev, p, &frac) && t->n_cross < REPLAY_MAX_LAPS) {
+        uint32_t step_ms = (d->gnss_ms + GNSS_DAY_MS - t->prev_gnss_ms) % GNSS_DAY_MS;
+        t->cross_ms[t->n_cross++] = t->prev_gnss_ms + (double)frac * step_ms;
+    }
+    t->prev = p;
+    t->prev_gnss_ms = d->gnss_ms;
+    t->has_prev = true;
+}
+
+#endif
@@ -0,0 +1,176 @@
+// Dead reckoning CTRV num buraco de sinal. Como no telemetry_gps.c, a
+// taxa de curva sai de duas fixes a 200 ms uma da outra e a posição é
+// extrapolada da mais nova.
+#include "replay_util.h"
+
+#define R_M      40.0
+#define V_MS     15.0
+#define W_RS     (V_MS / R_M)       // 0,375 rad/s, curva à esquerda
+#define TH0      (M_PI / 2)
+#define BASE_MS  200
+
+static geo_proj_t pj;
+
+static geo_point_t truth(double t) {
+    double th = TH0 - W_RS * t;
+    return (geo_point_t){ (float)(R_M * (cos(th) - cos(TH0))), (float)(-R_M * (sin(th) - sin(TH0))) };
+}
+
+static gps_data_t fix_at(uint32_t ms) {
+    double t = ms * 1e-3;
+    gps_data_t d = { .valid = true, .sats = 10, .timestamp_ms = ms, .gnss_ms = ms };
+    geo_unproject(&pj, truth(t), &d.lat_e7, &d.lon_e7);
+    d.speed_mms = (int32_t)lround(V_MS * 1000);
+    double crs = fmod((TH0 - W_RS * t) * 180 / M_PI + 3600.0, 360.0);
+    d.course_cd = (uint16_t)((uint32_t)lround(crs * 100) % 36000);
+    return d;
+}
+
+static float dist_to_truth(const gps_data_t *g, double t) {
+    geo_point_t p = geo_project(&pj, g->lat_e7, g->lon_e7), q = truth(t);
+    return hypotf(p.x - q.x, p.y - q.y);
+}
+
+// Na curva a CTRV segue o arco; em linha reta o erro seria v·t²·w/2
+static void test_arc(void) {
+    uint32_t drop = 4000;
+    gps_data_t a = fix_at(drop - BASE_MS), b = fix_at(drop), out;
+    for (uint32_t dt = 100; dt <= 3000; dt += 100) {
+        gps_dr_ctrv(&a, &b, dt, &out);
+        CHECK(out.valid && out.estimated);
+        CHECK_INT(out.timestamp_ms, drop + dt);
+        CHECK(dist_to_truth(&out, (drop + dt) * 1e-3) < 0.1f + 0.05f * dt / 1000.0f);
+    }
+    // Rumo no fim do buraco: a taxa vem de rumos em 0,01° a 200 ms um do
+    // outro, então pode errar até 0,05 °/s (0,15° em 3 s)
+    gps_dr_ctrv(&a, &b, 3000, &out);
+    gps_data_t t3 = fix_at(drop + 3000);
+    CHECK_NEAR(out.course_cd, t3.course_cd, 15);
+
+    // A mesma extrapolação sem a taxa de curva (uma fix só de base)
+    gps_dr_ctrv(&b, &b, 1000, &out);
+    CHECK(dist_to_truth(&out, (drop + 1000) * 1e-3) > 2.5f);
+}
+
+// A linha cai no meio do buraco: os pontos estimados a 10 Hz ainda
+// cruzam o portão, e o instante interpolado fica a poucos ms do real
+static void test_gate_in_dropout(void) {
+    const double t_cross = 9.35;
+    geo_gate_t g;
+    double th = TH0 - W_RS * t_cross;
+    geo_gate_init(&g, truth(t_cross), (float)(th * 180 / M_PI), 6.0f);
+
+    uint32_t drop = 8500; // Último fix 850 ms antes da linha
+    gps_data_t a = fix_at(drop - BASE_MS), b = fix_at(drop), prev = b, cur;
+    int crossings = 0;
+    double t_lap = 0;
+    for (uint32_t dt = 100; dt <= 2000; dt += 100, prev = cur) {
+        gps_dr_ctrv(&a, &b, dt, &cur);
+        float frac;
+        geo_point_t p0 = geo_project(&pj, prev.lat_e7, prev.lon_e7), p1 = geo_project(&pj, cur.lat_e7, cur.lon_e7);
+        if (geo_gate_cross(&g, p0, p1, &frac)) {
+            crossings++;
+            t_lap = prev.timestamp_ms + frac * (cur.timestamp_ms - prev.timestamp_ms);
+        }
+    }
+    CHECK_INT(crossings, 1);
+    CHECK_NEAR(t_lap, t_cross * 1000, 5.0);
+}
+
+static void test_limits(void) {
+    gps_data_t a = fix_at(1000), b = fix_at(1200), out;
+
+    // Reta: rumo igual nas duas, anda v·t no rumo
+    a.course_cd = b.course_cd = 0;
+    gps_dr_ctrv(&a, &b, 2000, &out);
+    geo_point_t p0 = geo_project(&pj, b.lat_e7, b.lon_e7), p1 = geo_project(&pj, out.lat_e7, out.lon_e7);
+    CHECK_NEAR(p1.y - p0.y, 30.0, 0.05);
+    CHECK_NEAR(p1.x - p0.x, 0.0, 0.05);
+
+    // Devagar (< 3 m/s) o rumo do GNSS é ruído: nada de curva
+    a.course_cd = 0; b.course_cd = 4500;
+    a.speed_mms = b.speed_mms = 2000;
+    gps_dr_ctrv(&a, &b, 1000, &out);
+    CHECK_INT(out.course_cd, 4500);
+
+    // Salto de 90° em 200 ms vira no máximo 1,5 rad/s
+    a.speed_mms = b.speed_mms = 15000;
+    a.course_cd = 0; b.course_cd = 9000;
+    gps_dr_ctrv(&a, &b, 1000, &out);
+    CHECK_NEAR(out.course_cd, 9000 + 1.5 * 18000 / M_PI, 2);
+
+    // gnss_ms dá a volta à meia-noite
+    b.gnss_ms = GNSS_DAY_MS - 300;
+    gps_dr_ctrv(&a, &b, 500, &out);
+    CHECK_INT(out.gnss_ms, 200);
+}
+
+// Buracos de 1 a 3 s nas fixes gravadas, centrados em cada passagem pela
+// linha. As fixes do buraco viram estimativas, com a âncora e o passo do
+// dr_note/dr_estimate; a posição e a volta são comparadas com as fixes
+// reais que foram apagadas.
+static void test_recorded_holes(void) {
+    replay_t r;
+    CHECK(replay_load(&r, "sessao_oval_imu.txt"));
+    static gps_data_t fix[1024];
+    int n = 0;
+    for (int i = 0; i < r.n_ev && n < 1024; i++)
+        if (r.ev[i].kind == 'G') fix[n++] = r.ev[i].fix;
+
+    geo_proj_t rp;
+    geo_proj_init(&rp, r.line_lat, r.line_lon);
+    replay_timer_t real;
+    replay_timer_init(&real, &rp, &r);
+    for (int i = 0; i < n; i++) replay_timer_feed(&real, &fix[i]);
+    CHECK_INT(real.n_cross, r.n_truth);
+
+    float worst_pos = 0;
+    double worst_cross = 0;
+    for (int k = 0; k < real.n_cross; k++) {
+        for (uint32_t hole = 1000; hole <= 3000; hole += 1000) {
+            uint32_t start = (uint32_t)real.cross_ms[k] - hole / 2, end = start + hole;
+            replay_timer_t est_t;
+            replay_timer_init(&est_t, &rp, &r);
+            gps_data_t base[3];
+            int n_base = 0;
+            float pos_max = 0;
+            for (int i = 0; i < n; i++) {
+                gps_data_t d = fix[i];
+                if (d.gnss_ms >= start && d.gnss_ms < end && n_base == 2) {
+                    uint32_t dt = d.timestamp_ms - base[2].timestamp_ms;
+                    gps_dr_ctrv(&base[0], &base[2], dt, &d);
+                    geo_point_t p = geo_project(&rp, d.lat_e7, d.lon_e7), q = geo_project(&rp, fix[i].lat_e7, fix[i].lon_e7);
+                    pos_max = fmaxf(pos_max, hypotf(p.x - q.x, p.y - q.y));
+                } else if (n_base == 0) {
+                    base[1] = base[2] = d;
+                    n_base = 1;
+                } else {
+                    if (d.timestamp_ms - base[1].timestamp_ms >= BASE_MS) { base[0] = base[1]; base[1] = d; n_base = 2; }
+                    base[2] = d;
+                }
+                replay_timer_feed(&est_t, &d);
+            }
+            CHECK_INT(est_t.n_cross, real.n_cross);
+            double err = fabs(est_t.cross_ms[k] - real.cross_ms[k]);
+            // A linha fica no meio da reta, com o kart ainda acelerando
+            // (até ~0,6 g): a velocidade constante da CTRV fica para trás e
+            // o erro cresce com o quadrado do buraco
+            double h_s = hole / 1000.0;
+            CHECK(err < 50.0 * h_s * h_s);
+            CHECK(pos_max < 2.0 * h_s * h_s);
+            if (pos_max > worst_pos) worst_pos = pos_max;
+            if (err > worst_cross) worst_cross = err;
+        }
+    }
+    printf("buracos de 1-3 s: pior posição %.2f m, pior passagem %.1f ms\n", worst_pos, worst_cross);
+    replay_free(&r);
+}
+
+int main(void) {
+    geo_proj_init(&pj, -237020575, -466923868);
+    test_arc();
+    test_gate_in_dropout();
+    test_limits();
+    test_recorded_holes();
+    return TEST_END();
+}
@@ -0,0 +1,138 @@
+// EKF GPS + IMU com fixes atrasadas. Pista: círculo de 50 m a 20 m/s
+// para a esquerda; IMU a 100 Hz com bias, GNSS a 10 Hz com ruído, que
+// chega 'LAT_MS' depois da medida. O ruído sai de um gerador fixo, então
+// o resultado é o mesmo em toda execução.
+#include "test_util.h"
+#include "gps_fusion.h"
+
+#define R_M      50.0
+#define V_MS     20.0
+#define W_RS     (V_MS / R_M)
+#define TH0      (M_PI / 2)         // Parte para leste
+#define LAT_MS   60
+#define BIAS_A   0.15               // m/s²
+#define BIAS_G   0.6                // °/s
+#define RUN_MS   30000
+
+static uint32_t rng = 12345;
+static double gauss(void) {
+    double s = 0;
+    for (int i = 0; i < 12; i++) { rng = rng * 1664525u + 1013904223u; s += (rng >> 8) / 16777216.0; }
+    return s - 6.0;
+}
+
+// Posição verdadeira: rumo th = TH0 - w t (curva à esquerda diminui o rumo)
+static geo_point_t truth(double t) {
+    double th = TH0 - W_RS * t;
+    return (geo_point_t){ (float)(R_M * (cos(th) - cos(TH0))), (float)(-R_M * (sin(th) - sin(TH0))) };
+}
+
+static gps_data_t make_fix(const geo_proj_t *pj, double t, double noise_m) {
+    gps_data_t d = { .valid = true, .sats = 12 };
+    geo_point_t p = truth(t);
+    p.x += (float)(noise_m * gauss());
+    p.y += (float)(noise_m * gauss());
+    geo_unproject(pj, p, &d.lat_e7, &d.lon_e7);
+    d.speed_mms = (int32_t)lround(V_MS * 1000 + 50 * gauss());
+    double crs = fmod((TH0 - W_RS * t) * 180 / M_PI + 0.3 * gauss() + 3600.0, 360.0);
+    d.course_cd = (uint16_t)((uint32_t)lround(crs * 100) % 36000);
+    d.gnss_ms = (uint32_t)lround(t * 1000);
+    return d;
+}
+
+// Roda a volta toda; 'replay' = informa o instante real da medida (senão,
+// a fix é tratada como medida na chegada). Retorna o erro RMS da head.
+static double run(bool replay, gps_fusion_t *f) {
+    geo_proj_t pj;
+    geo_proj_init(&pj, -237020575, -466923868);
+    gps_fusion_reset(f);
+    gps_data_t out, pending[4];
+    int n_pend = 0;
+    double err2 = 0;
+    int n_err = 0;
+
+    for (uint32_t ms = 0; ms <= RUN_MS; ms++) {
+        double t = ms * 1e-3;
+        if (ms % 100 == 0) pending[n_pend++] = make_fix(&pj, t, 0.3);
+        // Chegada: a mais antiga da fila, LAT_MS depois da medida
+        if (n_pend && ms == pending[0].gnss_ms + LAT_MS) {
+            pending[0].timestamp_ms = ms;
+            uint32_t t_meas_ms = replay ? pending[0].gnss_ms : ms;
+            gps_fusion_fix(f, &pending[0], t_meas_ms * 1000u);
+            memmove(pending, pending + 1, --n_pend * sizeof(pending[0]));
+        }
+        if (ms % 10 == 0) {
+            double a = BIAS_A + 0.2 * gauss();
+            double w = W_RS * 180 / M_PI + BIAS_G + 0.3 * gauss(); // + = esquerda
+            gps_fusion_imu(f, ms * 1000u, (float)(a / 9.80665), (float)w);
+            // Erro da head no instante que ela diz representar (depois de 5 s)
+            if (ms > 5000 && gps_fusion_output(f, &out)) {
+                geo_point_t p = geo_project(&pj, out.lat_e7, out.lon_e7), q = truth(out.timestamp_ms * 1e-3);
+                err2 += (p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y);
+                n_err++;
+            }
+        }
+    }
+    return sqrt(err2 / n_err);
+}
+
+static void test_delayed_replay(void) {
+    gps_fusion_t f;
+    gps_data_t out;
+    gps_fusion_reset(&f);
+    CHECK(!gps_fusion_output(&f, &out));
+
+    double e_replay = run(true, &f);
+    float ba = f.s[4], bg = f.s[5];
+    gps_fusion_output(&f, &out);
+    double e_naive = run(false, &f);
+    printf("erro RMS da head: %.3f m com a fix no instante certo, %.3f m sem\n", e_replay, e_naive);
+
+    // A 20 m/s, 60 ms de atraso não compensado já são 1,2 m de erro
+    CHECK(e_replay < 0.35);
+    CHECK(e_naive > 2.0 * e_replay);
+    // Bias aprendidos (o de guinada no sinal do rumo: rad/s, horário)
+    CHECK_NEAR(ba, BIAS_A, 0.1);
+    CHECK_NEAR(-bg * 180 / M_PI, BIAS_G, 0.15);
+    CHECK_NEAR(out.speed_mms, V_MS * 1000, 150);
+    CHECK_INT(out.sats, 12);
+}
+
+// Uma fix 40 m fora é recusada; depois de MAX_REJECTS seguidas o filtro
+// reinicia nelas (o erro era dele)
+static void test_outlier(void) {
+    geo_proj_t pj;
+    geo_proj_init(&pj, -237020575, -466923868);
+    gps_fusion_t f;
+    gps_fusion_reset(&f);
+    gps_data_t d = { .valid = true, .speed_mms = 10000, .course_cd = 9000 }, out;
+    geo_unproject(&pj, (geo_point_t){ 0, 0 }, &d.lat_e7, &d.lon_e7);
+    uint32_t t_us = 0;
+    for (int k = 0; k <= 20; k++) {
+        for (int i = 0; i < 10; i++, t_us += 10000) gps_fusion_imu(&f, t_us, 0, 0);
+        geo_unproject(&pj, (geo_point_t){ 10.0f * k * 0.1f, 0 }, &d.lat_e7, &d.lon_e7);
+        d.timestamp_ms = t_us / 1000;
+        gps_fusion_fix(&f, &d, t_us);
+    }
+    gps_fusion_output(&f, &out);
+    geo_point_t before = geo_project(&pj, out.lat_e7, out.lon_e7);
+
+    geo_unproject(&pj, (geo_point_t){ before.x + 1.0f, 40.0f }, &d.lat_e7, &d.lon_e7);
+    for (int i = 0; i < 10; i++, t_us += 10000) gps_fusion_imu(&f, t_us, 0, 0);
+    gps_fusion_fix(&f, &d, t_us);
+    gps_fusion_output(&f, &out);
+    geo_point_t p = geo_project(&pj, out.lat_e7, out.lon_e7);
+    CHECK(fabsf(p.y) < 1.0f);
+    CHECK_INT(f.rejects, 1);
+
+    for (int k = 0; k < 5; k++) gps_fusion_fix(&f, &d, t_us);
+    gps_fusion_output(&f, &out);
+    p = geo_project(&pj, out.lat_e7, out.lon_e7);
+    CHECK_NEAR(p.y, 40.0, 0.5);
+}
+
+int main(void) {
+    test_delayed_replay();
+    test_outlier();
+    return TEST_END();
+}
@@ -0,0 +1,121 @@
+// Anti-alias + decimação do IMU (caminho C do host, mesma forma direta II
+// do dsps_biquad_f32). Parâmetros do firmware: 1 kHz, Butterworth de 4a
+// ordem em 25 Hz, decimação por 10 (config.h puxa o IDF, então ficam aqui).
+#include "test_util.h"
+#include "imu_filter.h"
+
+#define FS      1000.0f
+#define FC      25.0f
+#define ORDER   4
+#define DECIM   10
+#define N       4000
+
+static mpu_raw_t in[N];
+static imu_filter_out_t out[N / DECIM + 1];
+
+// Seno de amplitude 'amp' em todos os canais (giro em fase invertida)
+static void fill_sine(float hz, float amp, float dc) {
+    for (int i = 0; i < N; i++) {
+        float v = dc + amp * sinf(2.0f * (float)M_PI * hz * i / FS);
+        for (int c = 0; c < 3; c++) {
+            in[i].acc[c] = (int16_t)lroundf(v);
+            in[i].gyro[c] = (int16_t)lroundf(-v);
+        }
+    }
+}
+
+// Amplitude de pico da saída depois do transitório (última metade)
+static float out_amp(int n_out, float dc) {
+    float m = 0;
+    for (int i = n_out / 2; i < n_out; i++) {
+        float a = fabsf(out[i].acc[0] - dc);
+        if (a > m) m = a;
+    }
+    return m;
+}
+
+static void test_dc(void) {
+    imu_filter_t f;
+    imu_filter_init(&f, FS, FC, ORDER, DECIM);
+    fill_sine(0.0f, 0.0f, 16384.0f); // 1 g parado
+    int n = imu_filter_run(&f, in, N, out);
+    CHECK_INT(n, N / DECIM);
+    // Estado já parte em regime: sem degrau desde a primeira saída
+    CHECK_NEAR(out[0].acc[2], 16384.0, 0.5);
+    CHECK_NEAR(out[n - 1].acc[2], 16384.0, 0.5);
+    CHECK_NEAR(out[n - 1].gyro[1], -16384.0, 0.5);
+    CHECK_INT(out[0].src, DECIM - 1);
+    CHECK_INT(out[n - 1].src, N - 1);
+}
+
+static void test_response(void) {
+    imu_filter_t f;
+    struct { float hz, gain, tol; } pts[] = {
+        { 2.0f, 1.0f, 0.01f },          // Frenagem/curva: passa inteiro
+        { FC, 0.7071f, 0.02f },         // -3 dB no corte
+        { 150.0f, 0.0f, 0.001f },       // Vibração do motor: > 60 dB abaixo
+        { 410.0f, 0.0f, 0.001f },       // Dobraria para 10 Hz na saída de 100 Hz
+    };
+    for (size_t k = 0; k < sizeof(pts) / sizeof(pts[0]); k++) {
+        imu_filter_init(&f, FS, FC, ORDER, 1);
+        fill_sine(pts[k].hz, 4000.0f, 0.0f);
+        static imu_filter_out_t full[N];
+        int n = imu_filter_run(&f, in, N, full);
+        CHECK_INT(n, N);
+        float m = 0;
+        for (int i = N / 2; i < N; i++) if (fabsf(full[i].acc[0]) > m) m = fabsf(full[i].acc[0]);
+        CHECK_NEAR(m / 4000.0f, pts[k].gain, pts[k].tol);
+    }
+}
+
+// Rampa: em regime a saída fica atrás exatamente imu_filter_delay() amostras
+static void test_delay(void) {
+    imu_filter_t f;
+    imu_filter_init(&f, FS, FC, ORDER, DECIM);
+    for (int i = 0; i < N; i++) {
+        int16_t v = (int16_t)(i * 4 - 8000);
+        for (int c = 0; c < 3; c++) in[i].acc[c] = in[i].gyro[c] = v;
+    }
+    int n = imu_filter_run(&f, in, N, out);
+    const imu_filter_out_t *o = &out[n - 1];
+    float lag = (o->src * 4 - 8000 - o->acc[0]) / 4.0f;
+    CHECK_NEAR(lag, imu_filter_delay(&f), 0.05);
+    CHECK(imu_filter_delay(&f) > 10.0f && imu_filter_delay(&f) < 30.0f);
+}
+
+// Rajadas de tamanho qualquer (o FIFO entrega 40 por vez, às vezes menos)
+// dão a mesma saída de uma passada só
+static void test_chunks(void) {
+    imu_filter_t f1, f2;
+    static imu_filter_out_t ref[N / DECIM + 1];
+    imu_filter_init(&f1, FS, FC, ORDER, DECIM);
+    imu_filter_init(&f2, FS, FC, ORDER, DECIM);
+    fill_sine(7.0f, 3000.0f, 500.0f);
+    int n_ref = imu_filter_run(&f1, in, N, ref);
+
+    int n = 0, pos = 0;
+    static const int burst[] = { 40, 37, 1, 40, 13, 97, 40 };
+    for (int k = 0; pos < N; k++) {
+        int m = burst[k % 7];
+        if (m > N - pos) m = N - pos;
+        int got = imu_filter_run(&f2, in + pos, m, out + n);
+        CHECK(got <= m / DECIM + 1);
+        for (int i = 0; i < got; i++) out[n + i].src += pos;
+        n += got;
+        pos += m;
+    }
+    CHECK_INT(n, n_ref);
+    for (int i = 0; i < n && i < n_ref; i++) {
+        CHECK_INT(out[i].src, ref[i].src);
+        CHECK_NEAR(out[i].acc[1], ref[i].acc[1], 1e-2);
+    }
+    CHECK_NEAR(out_amp(n, 500.0f), 3000.0f, 30.0f);
+}
+
+int main(void) {
+    test_dc();
+    test_response();
+    test_delay();
+    test_chunks();
+    return TEST_END();
+}
@@ -0,0 +1,73 @@
+// Referência indexada por distância: reamostragem na grade de 1 m e
+// consulta interpolada, como o delta ao vivo usa.
+#include "test_util.h"
+#include "lap_delta.h"
+
+#define REF_M 1000
+
+// Volta sintética: 20 m/s até os 200 m, 10 m/s depois (freada na curva)
+static float lap_dist(uint32_t t_ms) {
+    float t = t_ms / 1000.0f;
+    return (t <= 10.0f) ? t * 20.0f : 200.0f + (t - 10.0f) * 10.0f;
+}
+
+static uint32_t lap_time(float d) {
+    return (uint32_t)lroundf(d <= 200.0f ? d * 50.0f : 10000.0f + (d - 200.0f) * 100.0f);
+}
+
+static void test_build_lookup(void) {
+    static lap_point_t pts[1024];
+    static uint32_t grid[REF_M];
+    lap_trace_t tr = { .pts = pts, .cap = 1024 };
+    lap_ref_t ref = { .t_ms = grid, .cap = REF_M };
+
+    // Parado na linha antes de sair: distância repetida não pode quebrar
+    lap_trace_reset(&tr);
+    lap_trace_add(&tr, 0.0f, 0);
+    lap_trace_add(&tr, 0.0f, 0);
+    for (uint32_t t = 100; t <= 60000; t += 100) lap_trace_add(&tr, lap_dist(t), t);
+    lap_ref_build(&ref, &tr);
+    CHECK_INT(ref.n, 701); // 0..700 m
+
+    for (float d = 0.0f; d < 699.0f; d += 7.3f) {
+        uint32_t t;
+        CHECK(lap_ref_lookup(&ref, d, &t));
+        CHECK_NEAR(t, lap_time(d), 1.0);
+    }
+
+    // Delta de uma volta 5% mais rápida aos 450 m
+    uint32_t t_ref, t_now = (uint32_t)(lap_time(450.0f) * 0.95f);
+    CHECK(lap_ref_lookup(&ref, 450.0f, &t_ref));
+    CHECK_NEAR((int32_t)t_now - (int32_t)t_ref, -1750, 2.0);
+
+    // Além do fim da referência não há delta
+    uint32_t t;
+    CHECK(!lap_ref_lookup(&ref, 700.5f, &t));
+}
+
+// Trajetória maior que o buffer e volta maior que a grade
+static void test_limits(void) {
+    static lap_point_t pts[50];
+    static uint32_t grid[100];
+    lap_trace_t tr = { .pts = pts, .cap = 50 };
+    lap_ref_t ref = { .t_ms = grid, .cap = 100 };
+
+    lap_trace_reset(&tr);
+    for (uint32_t i = 0; i < 80; i++) lap_trace_add(&tr, i * 5.0f, i * 250);
+    CHECK_INT(tr.n, 50);
+    lap_ref_build(&ref, &tr);
+    CHECK_INT(ref.n, 100);
+    CHECK_INT(ref.t_ms[99], 4950);
+
+    // Um ponto só não forma referência
+    lap_trace_reset(&tr);
+    lap_trace_add(&tr, 0.0f, 0);
+    lap_ref_build(&ref, &tr);
+    CHECK_INT(ref.n, 0);
+}
+
+int main(void) {
+    test_build_lookup();
+    test_limits();
+    return TEST_END();
+}
@@ -0,0 +1,105 @@
+// Codec de blocos do log contra um .kbl gravado: sessão 7, três blocos
+// íntegros de 25 registros (troca de volta no meio do 2o) e um 4o bloco
+// cortado pela metade, seguido da área pré-alocada zerada.
+#include "test_util.h"
+#include "log_codec.h"
+#include "log_format.h"
+
+#define BLK_RECS 25
+
+static uint8_t file[4096];
+static size_t file_len;
+static log_codec_t codec;
+
+static void load(void) {
+    FILE *f = test_fixture("sessao_7.kbl");
+    file_len = fread(file, 1, sizeof(file), f);
+    fclose(f);
+    uint8_t widths[LOG_CODEC_MAX_FIELDS];
+    CHECK(log_codec_init(&codec, widths, log_field_widths(widths)));
+    CHECK_INT(codec.rec_size, LOG_REC_SIZE);
+}
+
+// O cabeçalho do arquivo é byte a byte o que o firmware monta hoje
+static void test_header(void) {
+    gps_data_t start = { .valid = true, .timestamp_ms = 123456,
+                         .year = 26, .month = 8, .day = 17, .hour = 12, .minute = 30, .second = 12 };
+    uint8_t hdr[LOG_HDR_SIZE];
+    CHECK_INT(log_build_header(hdr, 7, &start, LOG_FLAG_BLOCKS), LOG_HDR_SIZE);
+    CHECK(memcmp(hdr, file, LOG_HDR_SIZE) == 0);
+}
+
+static void test_blocks(void) {
+    uint8_t recs[BLK_RECS * LOG_REC_SIZE], prev[LOG_REC_SIZE], enc[1024];
+    size_t pos = LOG_HDR_SIZE, used;
+    int total = 0, n;
+
+    while ((n = log_block_decode(&codec, file + pos, file_len - pos, recs, BLK_RECS, &used)) >= 0) {
+        CHECK_INT(n, BLK_RECS);
+        // Cadeia de sequência e t_ms contínua, inclusive entre blocos
+        for (int i = 0; i < n; i++) {
+            if (total + i > 0) CHECK(log_record_follows(prev, recs + i * LOG_REC_SIZE));
+            memcpy(prev, recs + i * LOG_REC_SIZE, LOG_REC_SIZE);
+        }
+        // Reencodar dá os mesmos bytes do arquivo (formato congelado)
+        size_t sz = log_block_encode(&codec, recs, (uint16_t)n, enc, sizeof(enc));
+        CHECK_INT(sz, used);
+        CHECK(memcmp(enc, file + pos, used) == 0);
+        CHECK(used * 3 < (size_t)n * LOG_REC_SIZE * 2); // 10 Hz a ~100 km/h: < 2/3 do bruto
+        total += n;
+        pos += used;
+    }
+    // O bloco cortado não passa, e os anteriores valem todos
+    CHECK_INT(total, 75);
+    CHECK(pos < file_len);
+
+    // Último registro íntegro: t_ms, posição, volta 1 e seq 10 no modo RACE
+    gps_data_t g = { .timestamp_ms = 130856, .lat_e7 = -237140800, .lon_e7 = -466889593, .speed_mms = 27860 };
+    uint8_t rec[LOG_REC_SIZE];
+    log_encode_sample(rec, &g, MODE_CORRIDA, 1, 74);
+    CHECK(memcmp(rec, prev, LOG_REC_SIZE) == 0);
+}
+
+// Qualquer byte trocado no payload ou no CRC derruba o bloco
+static void test_crc(void) {
+    uint8_t blk[1024], recs[BLK_RECS * LOG_REC_SIZE];
+    size_t used;
+    CHECK_INT(log_block_decode(&codec, file + LOG_HDR_SIZE, file_len - LOG_HDR_SIZE, recs, BLK_RECS, &used), BLK_RECS);
+    for (size_t i = LOG_BLOCK_HDR_SIZE - 4; i < used; i += 7) {
+        memcpy(blk, file + LOG_HDR_SIZE, used);
+        blk[i] ^= 0x10;
+        CHECK_INT(log_block_decode(&codec, blk, used, recs, BLK_RECS, NULL), -1);
+    }
+    // Mais registros que o destino comporta, ou bloco incompleto
+    CHECK_INT(log_block_decode(&codec, file + LOG_HDR_SIZE, used, recs, BLK_RECS - 1, NULL), -1);
+    CHECK_INT(log_block_decode(&codec, file + LOG_HDR_SIZE, used - 1, recs, BLK_RECS, NULL), -1);
+}
+
+// Campos que dão a volta: u16 65535 -> 0, u32 através do sinal, u8 255 -> 0
+static void test_wrap(void) {
+    static const uint8_t widths[] = { 4, 2, 1 };
+    log_codec_t c;
+    CHECK(log_codec_init(&c, widths, 3));
+    uint8_t recs[3][7] = {
+        { 0xFF, 0xFF, 0xFF, 0x7F, 0xFF, 0xFF, 0xFF },
+        { 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00 },
+        { 0x05, 0x00, 0x00, 0x00, 0x10, 0x27, 0x7F },
+    };
+    uint8_t blk[LOG_BLOCK_HDR_SIZE + 3 * 3 * 5], out[3][7];
+    CHECK(sizeof(blk) == LOG_BLOCK_MAX_SIZE(&c, 3));
+    size_t sz = log_block_encode(&c, &recs[0][0], 3, blk, sizeof(blk));
+    CHECK(sz > 0);
+    CHECK_INT(log_block_decode(&c, blk, sz, &out[0][0], 3, NULL), 3);
+    CHECK(memcmp(recs, out, sizeof(recs)) == 0);
+    // Sem espaço: encode devolve 0 em vez de truncar
+    CHECK_INT(log_block_encode(&c, &recs[0][0], 3, blk, sz - 1), 0);
+}
+
+int main(void) {
+    load();
+    test_header();
+    test_blocks();
+    test_crc();
+    test_wrap();
+    return TEST_END();
+}
@@ -0,0 +1,192 @@
+// Driver do MPU-6050 contra um barramento simulado: sequência de
+// registradores do init, FIFO em quadros inteiros e em rajadas, reset do
+// transbordo e o instante de cada amostra a partir do data-ready.
+#include "test_util.h"
+#include "mpu6050.h"
+
+// --- Barramento simulado ---
+typedef struct {
+    uint8_t who, int_status;
+    uint8_t fifo[MPU_FIFO_SIZE];
+    int fifo_len;
+    uint8_t wr_reg[32], wr_val[32];
+    int n_wr;
+    size_t rd_len[32];          // Tamanho de cada leitura do FIFO_R_W
+    int n_rd, fail_rd;          // fail_rd: a leitura do FIFO_R_W nº fail_rd falha (0 = nunca)
+} fake_t;
+
+static int fake_write(void *ctx, uint8_t reg, const uint8_t *data, size_t len) {
+    fake_t *b = ctx;
+    for (size_t i = 0; i < len && b->n_wr < 32; i++, b->n_wr++) {
+        b->wr_reg[b->n_wr] = reg;
+        b->wr_val[b->n_wr] = data[i];
+    }
+    if (reg == MPU_REG_USER_CTRL && (data[0] & 0x04)) { b->fifo_len = 0; b->int_status = 0; }
+    return 0;
+}
+
+static int fake_read(void *ctx, uint8_t reg, uint8_t *data, size_t len) {
+    fake_t *b = ctx;
+    switch (reg) {
+    case MPU_REG_WHO_AM_I: data[0] = b->who; return 0;
+    case MPU_REG_INT_STATUS: data[0] = b->int_status; b->int_status = 0; return 0;
+    case MPU_REG_FIFO_COUNTH:
+        if (len != 2) return -1;
+        data[0] = (uint8_t)(b->fifo_len >> 8);
+        data[1] = (uint8_t)b->fifo_len;
+        return 0;
+    case MPU_REG_FIFO_R_W:
+        if (b->n_rd < 32) b->rd_len[b->n_rd] = len;
+        if (++b->n_rd == b->fail_rd) return -1;
+        if ((int)len > b->fifo_len) return -1;
+        memcpy(data, b->fifo, len);
+        b->fifo_len -= (int)len;
+        memmove(b->fifo, b->fifo + len, (size_t)b->fifo_len);
+        return 0;
+    }
+    return -1;
+}
+
+static fake_t fake;
+static const mpu_bus_t bus = { .write = fake_write, .read = fake_read, .ctx = &fake };
+
+static void fake_reset(void) {
+    memset(&fake, 0, sizeof(fake));
+    fake.who = MPU6050_WHO_AM_I_VAL;
+}
+
+// Quadro k: acel (k, -k, 1000 + k), giro (-2k, 2k, 300), big-endian
+static void push_frames(int first, int n) {
+    for (int k = first; k < first + n; k++) {
+        int16_t v[6] = { (int16_t)k, (int16_t)-k, (int16_t)(1000 + k), (int16_t)(-2 * k), (int16_t)(2 * k), 300 };
+        for (int a = 0; a < 6; a++) {
+            fake.fifo[fake.fifo_len++] = (uint8_t)((uint16_t)v[a] >> 8);
+            fake.fifo[fake.fifo_len++] = (uint8_t)v[a];
+        }
+    }
+}
+
+static void check_frame(const mpu_raw_t *s, int k) {
+    CHECK_INT(s->acc[0], k);
+    CHECK_INT(s->acc[1], -k);
+    CHECK_INT(s->acc[2], 1000 + k);
+    CHECK_INT(s->gyro[0], -2 * k);
+    CHECK_INT(s->gyro[1], 2 * k);
+    CHECK_INT(s->gyro[2], 300);
+}
+
+static void test_configure(void) {
+    fake_reset();
+    const mpu_config_t cfg = { .sample_hz = 500, .dlpf_cfg = 2, .accel_fs = 2, .gyro_fs = 1, .int_data_ready = true };
+    CHECK(mpu6050_configure(&bus, &cfg));
+    static const uint8_t reg[] = {
+        MPU_REG_PWR_MGMT_1, MPU_REG_CONFIG, MPU_REG_SMPLRT_DIV, MPU_REG_GYRO_CONFIG, MPU_REG_ACCEL_CONFIG,
+        MPU_REG_INT_PIN_CFG, MPU_REG_INT_ENABLE, MPU_REG_FIFO_EN, MPU_REG_USER_CTRL, MPU_REG_USER_CTRL,
+    };
+    static const uint8_t val[] = { 0x01, 0x02, 1, 1 << 3, 2 << 3, 0x10, MPU_INT_DATA_RDY, 0x78, 0x04, 0x40 };
+    CHECK_INT(fake.n_wr, sizeof(reg));
+    for (int i = 0; i < fake.n_wr && i < (int)sizeof(reg); i++) {
+        CHECK_INT(fake.wr_reg[i], reg[i]);
+        CHECK_INT(fake.wr_val[i], val[i]);
+    }
+
+    // Sem DLPF o FIFO encheria a 8 kHz: fica o 1; sem data-ready, INT desligado
+    fake_reset();
+    const mpu_config_t raw = { .sample_hz = 1000 };
+    CHECK(mpu6050_configure(&bus, &raw));
+    CHECK_INT(fake.wr_val[1], 1);
+    CHECK_INT(fake.wr_val[2], 0);
+    CHECK_INT(fake.wr_val[6], 0);
+
+    // Outro chip no endereço: nada é escrito
+    fake_reset();
+    fake.who = 0x70;
+    CHECK(!mpu6050_configure(&bus, &cfg));
+    CHECK_INT(fake.n_wr, 0);
+}
+
+static void test_fifo_frames(void) {
+    static mpu_raw_t out[MPU_FIFO_SIZE / MPU_FIFO_FRAME];
+    fake_reset();
+    // 85 quadros + 7 bytes do 86o: o pedaço fica no FIFO para a próxima
+    push_frames(0, 86);
+    fake.fifo_len -= MPU_FIFO_FRAME - 7;
+    CHECK_INT(mpu6050_fifo_read(&bus, out, 85, 480), 85);
+    for (int k = 0; k < 85; k++) check_frame(&out[k], k);
+    // Rajadas de 40 quadros (480 bytes) e o resto
+    CHECK_INT(fake.n_rd, 3);
+    CHECK_INT(fake.rd_len[0], 480);
+    CHECK_INT(fake.rd_len[1], 480);
+    CHECK_INT(fake.rd_len[2], 5 * MPU_FIFO_FRAME);
+    CHECK_INT(fake.fifo_len, 7);
+
+    // O resto do 86o chega: a leitura seguinte continua alinhada
+    fake.fifo_len = 0;
+    push_frames(85, 3);
+    fake.n_rd = 0;
+    CHECK_INT(mpu6050_fifo_read(&bus, out, 85, 20), 3);   // Rajada menor que um quadro: um por vez
+    for (int k = 0; k < 3; k++) check_frame(&out[k], 85 + k);
+    CHECK_INT(fake.n_rd, 3);
+
+    // Limite do destino: o que sobra fica no FIFO
+    push_frames(0, 10);
+    CHECK_INT(mpu6050_fifo_read(&bus, out, 4, 480), 4);
+    CHECK_INT(fake.fifo_len, 6 * MPU_FIFO_FRAME);
+
+    // Erro no meio: devolve o que já leu; na 1a rajada, -1
+    fake_reset();
+    push_frames(0, 60);
+    fake.fail_rd = 2;
+    CHECK_INT(mpu6050_fifo_read(&bus, out, 85, 480), 40);
+    fake.n_rd = 0;
+    fake.fail_rd = 1;
+    CHECK_INT(mpu6050_fifo_read(&bus, out, 85, 480), -1);
+}
+
+static void test_overflow(void) {
+    static mpu_raw_t out[MPU_FIFO_SIZE / MPU_FIFO_FRAME];
+    fake_reset();
+    push_frames(0, 85);
+    fake.int_status = MPU_INT_FIFO_OFLOW;
+    CHECK_INT(mpu6050_fifo_read(&bus, out, 85, 480), -2);
+    // Zera e religa o FIFO numa escrita só, sem ler os quadros desalinhados
+    CHECK_INT(fake.n_wr, 1);
+    CHECK_INT(fake.wr_reg[0], MPU_REG_USER_CTRL);
+    CHECK_INT(fake.wr_val[0], 0x44);
+    CHECK_INT(fake.n_rd, 0);
+    CHECK_INT(fake.fifo_len, 0);
+    // Dali em diante volta ao normal
+    push_frames(200, 2);
+    CHECK_INT(mpu6050_fifo_read(&bus, out, 85, 480), 2);
+    check_frame(&out[0], 200);
+}
+
+static void test_timestamps(void) {
+    const uint32_t p = 1000;
+    // 10 amostras, a mais nova no data-ready de 50000 us, lida 300 us depois
+    uint32_t t0 = mpu6050_burst_t0(50000, 50300, p, true, 10);
+    CHECK_INT(t0, 41000);
+    CHECK_INT(t0 + 9 * p, 50000);
+    // Sem o fio do INT vale o instante da leitura
+    CHECK_INT(mpu6050_burst_t0(50000, 50300, p, false, 10), 41300);
+    // Pulso parado há mais de dois períodos (INT solto): também a leitura
+    CHECK_INT(mpu6050_burst_t0(50000, 52001, p, true, 10), 43001);
+    CHECK_INT(mpu6050_burst_t0(50000, 52000, p, true, 10), 41000);
+    // Uma amostra: o próprio data-ready; nenhuma não quebra
+    CHECK_INT(mpu6050_burst_t0(50000, 50100, p, true, 1), 50000);
+    CHECK_INT(mpu6050_burst_t0(50000, 50100, p, true, 0), 50000);
+    // Contador de 32 bits dando a volta entre o pulso e a leitura
+    uint32_t ready = 0xFFFFFF00u;
+    t0 = mpu6050_burst_t0(ready, ready + 0x200, p, true, 3);
+    CHECK_INT(t0, ready - 2 * p);
+    CHECK_INT((uint32_t)(t0 + 2 * p), ready);
+    CHECK_INT(mpu6050_burst_t0(0x100, 0x300, p, true, 2), (uint32_t)(0x100 - p));
+}
+
+int main(void) {
+    test_configure();
+    test_fifo_frames();
+    test_overflow();
+    test_timestamps();
+    return TEST_END();
+}
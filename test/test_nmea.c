@@ -0,0 +1,73 @@
+// Parser NMEA byte a byte contra uma captura de 10 Hz (GGA+RMC, um GSV
+// no meio, lixo antes do primeiro '$' e uma GGA com checksum errado).
+#include "test_util.h"
+#include "gps_nmea.h"
+
+static void test_capture(void) {
+    FILE *f = test_fixture("interlagos_10hz.nmea");
+    gps_byte_source_t src = { .read = test_file_read, .ctx = f };
+    nmea_parser_t p;
+    nmea_parser_init(&p);
+    gps_data_t gps = {0};
+
+    // Fonte lida em blocos de 256: soma as GGA aceitas até o EOF
+    int fixes = 0, r;
+    while ((r = nmea_parser_pump(&p, &src, &gps)) != 0 || !feof(f)) {
+        CHECK(r >= 0);
+        if (r < 0) break;
+        fixes += r;
+    }
+    fclose(f);
+
+    CHECK_INT(fixes, 4); // 5 épocas, a 4a GGA não confere
+    CHECK(gps.valid);
+    CHECK_INT(gps.lat_e7, -237021242);
+    CHECK_INT(gps.lon_e7, -466923535);
+    CHECK_INT(gps.sats, 13);
+    CHECK_INT(gps.gnss_ms, (15 * 3600 + 30 * 60 + 12) * 1000u + 400);
+    CHECK_INT(gps.speed_mms, 27780); // 54 nós
+    CHECK_INT(gps.course_cd, 12345);
+    CHECK_INT(gps.hour, 12);         // UTC-3
+    CHECK_INT(gps.minute, 30);
+    CHECK_INT(gps.day, 17);
+    CHECK_INT(gps.month, 8);
+    CHECK_INT(gps.year, 26);
+}
+
+static void test_sentence(void) {
+    static const char gga[] = "$GNGGA,153012.00,2342.12345,S,04641.54321,W,1,09,0.9,780.0,M,-5.0,M,,*6E\r\n";
+    gps_data_t gps = {0};
+    CHECK(nmea_parse_sentence(gga, sizeof(gga) - 1, &gps));
+    CHECK_INT(gps.lat_e7, -237020575);
+    CHECK_INT(gps.lon_e7, -466923868);
+    CHECK_INT(gps.sats, 9);
+
+    // Um bit trocado no corpo: nada pode vazar para o gps_data_t
+    char bad[sizeof(gga)];
+    memcpy(bad, gga, sizeof(gga));
+    bad[20] ^= 0x01;
+    gps_data_t g2 = {0};
+    CHECK(!nmea_parse_sentence(bad, sizeof(bad) - 1, &g2));
+    CHECK_INT(g2.lat_e7, 0);
+
+    // RMC sozinha atualiza velocidade mas não fecha época
+    static const char rmc[] = "$GNRMC,153012.00,A,2342.12345,S,04641.54321,W,54.000,123.45,170826,,,A*41";
+    gps_data_t g3 = {0};
+    CHECK(!nmea_parse_sentence(rmc, sizeof(rmc) - 1, &g3));
+    CHECK_INT(g3.speed_mms, 27780);
+}
+
+// Um '$' no meio de uma sentença cortada ressincroniza o parser
+static void test_resync(void) {
+    static const char s[] = "$GNGGA,153012.00,2342.1$GNGGA,153012.00,2342.12345,S,04641.54321,W,1,09,0.9,780.0,M,-5.0,M,,*6E";
+    gps_data_t gps = {0};
+    CHECK(nmea_parse_sentence(s, sizeof(s) - 1, &gps));
+    CHECK_INT(gps.lat_e7, -237020575);
+}
+
+int main(void) {
+    test_capture();
+    test_sentence();
+    test_resync();
+    return TEST_END();
+}
@@ -0,0 +1,106 @@
+// Manifesto de sessões num diretório temporário: compactação pela troca
+// com .bak e recuperação de um corte em cada ponto dela.
+#include "test_util.h"
+#include "sd_manifest.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static char dir[] = "/tmp/kb_mfXXXXXX";
+static char mf[64], tmp[72], bak[72];
+
+static bool exists(const char *p) {
+    FILE *f = fopen(p, "rb");
+    if (f) fclose(f);
+    return f != NULL;
+}
+
+static long size_of(const char *p) {
+    FILE *f = fopen(p, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+static void put(uint16_t id, uint16_t laps) {
+    sd_session_t s = { .id = id, .state = SD_SESSION_OPEN, .laps = laps };
+    snprintf(s.name, sizeof(s.name), "S%u", id);
+    CHECK(sd_manifest_put(&s));
+}
+
+// 3 sessões, a última atualizada 40 vezes: a carga seguinte compacta
+static void fill(void) {
+    sd_manifest_clear();
+    CHECK(!sd_manifest_load(mf));
+    put(1, 5);
+    put(2, 7);
+    for (uint16_t i = 0; i < 40; i++) put(3, i);
+}
+
+static void check_list(void) {
+    CHECK_INT(sd_manifest_count(), 3);
+    const sd_session_t *s = sd_manifest_find(3);
+    CHECK(s && s->laps == 39);
+    s = sd_manifest_get(2);
+    CHECK(s && s->id == 1 && s->laps == 5);
+}
+
+static void test_compact(void) {
+    fill();
+    CHECK_INT(size_of(mf), 42 * (long)sizeof(sd_session_t));
+    CHECK(sd_manifest_load(mf));
+    check_list();
+    CHECK_INT(size_of(mf), 3 * (long)sizeof(sd_session_t));
+    CHECK(!exists(tmp));
+    CHECK(!exists(bak));
+    CHECK(sd_manifest_load(mf));
+    check_list();
+}
+
+static void test_recover(void) {
+    // Corte entre os renames: manifesto velho (sem a sessão 3) no .bak,
+    // .tmp completo
+    char held[80];
+    snprintf(held, sizeof(held), "%s/novo", dir);
+    fill();
+    CHECK(sd_manifest_load(mf));
+    rename(mf, held);
+    sd_manifest_clear();
+    CHECK(!sd_manifest_load(mf));
+    put(1, 5);
+    put(2, 7);
+    rename(mf, bak);
+    rename(held, tmp);
+    CHECK(sd_manifest_load(mf));
+    check_list();
+    CHECK_INT(size_of(mf), 3 * (long)sizeof(sd_session_t));
+    CHECK(!exists(tmp));
+    CHECK(!exists(bak));
+
+    // Só o .bak sobrou (o .tmp não chegou a existir no cartão)
+    rename(mf, bak);
+    CHECK(sd_manifest_load(mf));
+    check_list();
+    CHECK(!exists(bak));
+
+    // Corte escrevendo o .tmp: o manifesto continua o mesmo, sobra apagada
+    FILE *f = fopen(tmp, "wb");
+    fputs("x", f);
+    fclose(f);
+    CHECK(sd_manifest_load(mf));
+    check_list();
+    CHECK(!exists(tmp));
+}
+
+int main(void) {
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    snprintf(mf, sizeof(mf), "%s/sessions.idx", dir);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", mf);
+    snprintf(bak, sizeof(bak), "%s.bak", mf);
+    test_compact();
+    test_recover();
+    sd_manifest_clear();
+    rmdir(dir);
+    return TEST_END();
+}
@@ -0,0 +1,90 @@
+// Banco de pistas num diretório temporário: troca pelo .bak, recuperação
+// de um corte no meio e a cache da célula (busca sem pista por perto não
+// volta ao cartão).
+#include "test_util.h"
+#include "track_db.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static char dir[] = "/tmp/kb_tdbXXXXXX";
+static char db[64], bak[72];
+
+static bool exists(const char *p) {
+    FILE *f = fopen(p, "rb");
+    if (f) fclose(f);
+    return f != NULL;
+}
+
+static void add(const char *name, int32_t lat, int32_t lon) {
+    track_t t = { .lat_e7 = lat, .lon_e7 = lon, .heading_cd = 9000, .n_splits = 1 };
+    t.splits[0] = (track_split_t){ 12345, -6789, 18000 };
+    snprintf(t.name, sizeof(t.name), "%s", name);
+    CHECK(track_db_add(&t));
+}
+
+static void test_add_recover(void) {
+    track_t o;
+    CHECK(!track_db_open(db));
+    for (int i = 0; i < 5; i++) {
+        char n[8];
+        snprintf(n, sizeof(n), "P%d", i);
+        add(n, -235000000 + i * 1000000, -466000000);
+    }
+    CHECK_INT(track_db_count(), 5);
+    CHECK(track_db_find(-233000000, -466000000, 50, &o));
+    CHECK(strcmp(o.name, "P2") == 0);
+    CHECK_INT(o.splits[0].y_cm, -6789);
+
+    // Corte depois do 1o rename: só o .bak sobrou
+    rename(db, bak);
+    CHECK(track_db_open(db));
+    CHECK_INT(track_db_count(), 5);
+    CHECK(!exists(bak));
+    // Corte depois do 2o rename: banco novo + .bak velho
+    FILE *f = fopen(bak, "wb");
+    fputs("x", f);
+    fclose(f);
+    CHECK(track_db_open(db));
+    CHECK(!exists(bak));
+}
+
+static void test_cell_cache(void) {
+    // Pista e consultas na mesma célula de ~4,9 km, a ~2 km da linha
+    int32_t lat = -237020575, lon = -466923868, q_lat = lat - 180000;
+    CHECK(track_geohash(lat, lon) == track_geohash(q_lat, lon));
+    add("INTERLAGOS", lat, lon);
+    track_t o;
+    CHECK(!track_db_find(q_lat, lon, 1500, &o));
+
+    // Registro mexido no cartão para cair em cima da consulta: quem
+    // relesse o arquivo acharia a pista; a célula em cache continua "nada"
+    uint8_t buf[8192];
+    FILE *f = fopen(db, "r+b");
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    uint8_t *r = NULL;
+    for (size_t i = 0; i + 10 <= n && !r; i++) if (memcmp(buf + i, "INTERLAGOS", 10) == 0) r = buf + i;
+    CHECK(r != NULL);
+    if (!r) { fclose(f); return; }
+    uint8_t orig[4], patched[4] = { (uint8_t)q_lat, (uint8_t)(q_lat >> 8), (uint8_t)(q_lat >> 16), (uint8_t)(q_lat >> 24) };
+    long at = (long)(r - buf) + 32;
+    memcpy(orig, r + 32, 4);
+    fseek(f, at, SEEK_SET); fwrite(patched, 1, 4, f); fflush(f);
+    CHECK(!track_db_find(q_lat, lon, 1500, &o));
+    fseek(f, at, SEEK_SET); fwrite(orig, 1, 4, f);
+    fclose(f);
+
+    // Chegando perto: casa pela cache e só então lê o registro
+    CHECK(track_db_find(lat + 300, lon, 1500, &o));
+    CHECK(strcmp(o.name, "INTERLAGOS") == 0);
+}
+
+int main(void) {
+    if (!mkdtemp(dir)) return 2;
+    snprintf(db, sizeof(db), "%s/tracks.db", dir);
+    snprintf(bak, sizeof(bak), "%s.bak", db);
+    test_add_recover();
+    test_cell_cache();
+    remove(db);
+    rmdir(dir);
+    return TEST_END();
+}
@@ -0,0 +1,83 @@
+// Projeção local e portão virtual da linha de chegada.
+#include "test_util.h"
+#include "track_geo.h"
+
+#define LAT0 (-237020575)
+#define LON0 (-466923868)
+
+static void test_projection(void) {
+    geo_proj_t p;
+    geo_proj_init(&p, LAT0, LON0);
+
+    // Um grau a -23.7: 110753.9 m no meridiano, 101984.7 m no paralelo
+    geo_point_t n = geo_project(&p, LAT0 + 10000000, LON0);
+    geo_point_t e = geo_project(&p, LAT0, LON0 + 10000000);
+    CHECK_NEAR(n.y, 110753.9, 0.5);
+    CHECK_NEAR(n.x, 0.0, 1e-6);
+    CHECK_NEAR(e.x, 101984.7, 0.5);
+
+    // Ida e volta dentro de um kartódromo: no máximo 1e-7 grau (~1 cm)
+    for (int i = -20; i <= 20; i++) {
+        int32_t lat = LAT0 + i * 9137, lon = LON0 - i * 7211, lat2, lon2;
+        geo_unproject(&p, geo_project(&p, lat, lon), &lat2, &lon2);
+        CHECK(abs(lat2 - lat) <= 1);
+        CHECK(abs(lon2 - lon) <= 1);
+    }
+}
+
+static void test_gate(void) {
+    geo_gate_t g;
+    float frac = -1.0f;
+    // Linha em (0,0), rumo leste, 10 m para cada lado
+    geo_gate_init(&g, (geo_point_t){ 0.0f, 0.0f }, 90.0f, 10.0f);
+
+    // Trecho de 10 Hz a 30 m/s: cruza a 1/4 do caminho
+    CHECK(geo_gate_cross(&g, (geo_point_t){ -0.75f, 2.0f }, (geo_point_t){ 2.25f, 2.5f }, &frac));
+    CHECK_NEAR(frac, 0.25, 1e-5);
+    // Instante interpolado entre as fixes de 1000 e 1100 ms
+    CHECK_NEAR(1000.0f + frac * 100.0f, 1025.0, 1e-3);
+
+    // Na diagonal (30 graus do rumo) ainda conta
+    CHECK(geo_gate_cross(&g, (geo_point_t){ -1.0f, -1.0f }, (geo_point_t){ 2.0f, 0.732f }, &frac));
+    CHECK_NEAR(frac, 1.0 / 3.0, 1e-5);
+
+    // Contramão, fora da largura do portão e trecho que não chega à linha
+    CHECK(!geo_gate_cross(&g, (geo_point_t){ 1.0f, 0.0f }, (geo_point_t){ -1.0f, 0.0f }, &frac));
+    CHECK(!geo_gate_cross(&g, (geo_point_t){ -1.0f, 12.0f }, (geo_point_t){ 1.0f, 12.0f }, &frac));
+    CHECK(!geo_gate_cross(&g, (geo_point_t){ -3.0f, 0.0f }, (geo_point_t){ -1.0f, 0.0f }, &frac));
+
+    // Fix caindo exatamente na linha: conta uma vez só, no trecho seguinte
+    bool first = geo_gate_cross(&g, (geo_point_t){ -1.0f, 0.0f }, (geo_point_t){ 0.0f, 0.0f }, &frac);
+    bool second = geo_gate_cross(&g, (geo_point_t){ 0.0f, 0.0f }, (geo_point_t){ 1.0f, 0.0f }, &frac);
+    CHECK(!first);
+    CHECK(second);
+    CHECK_NEAR(frac, 0.0, 1e-6);
+
+    // Fix a um arredondamento da linha: um dos dois trechos conta, nunca
+    // nenhum ou os dois
+    int bad = 0;
+    for (int i = -500; i <= 500; i++) {
+        for (int k = -3; k <= 3; k++) {
+            geo_point_t m = { k * 1e-7f, i * 0.01f };
+            geo_point_t p0 = { m.x - 2.5f, m.y + 0.01f }, p1 = { m.x + 2.5f, m.y - 0.01f };
+            bad += geo_gate_cross(&g, p0, m, &frac) == geo_gate_cross(&g, m, p1, &frac);
+        }
+    }
+    CHECK_INT(bad, 0);
+
+    // Rumo norte-noroeste marcado em coordenadas reais
+    geo_proj_t p;
+    geo_proj_init(&p, LAT0, LON0);
+    geo_gate_init(&g, geo_project(&p, LAT0, LON0), 337.5f, 8.0f);
+    geo_point_t a = geo_project(&p, LAT0 - 400, LON0 + 200);
+    geo_point_t b = geo_project(&p, LAT0 + 1200, LON0 - 500);
+    CHECK(geo_gate_cross(&g, a, b, &frac));
+    CHECK(frac > 0.0f && frac < 1.0f);
+    CHECK(!geo_gate_cross(&g, b, a, &frac));
+}
+
+int main(void) {
+    test_projection();
+    test_gate();
+    return TEST_END();
+}
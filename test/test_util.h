@@ -0,0 +1,45 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Asserções mínimas: a falha imprime onde foi e conta; main() retorna
+// TEST_END() (0 se nada falhou), que é o que o ctest olha.
+static int test_failures __attribute__((unused));
+
+#define CHECK(cond) do { \
+    if (!(cond)) { fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond); test_failures++; } \
+} while (0)
+
+#define CHECK_INT(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { fprintf(stderr, "%s:%d: %s = %lld, esperado %lld\n", __FILE__, __LINE__, #a, _a, _b); test_failures++; } \
+} while (0)
+
+#define CHECK_NEAR(a, b, tol) do { \
+    double _a = (double)(a), _b = (double)(b); \
+    if (!(fabs(_a - _b) <= (tol))) { fprintf(stderr, "%s:%d: %s = %.6f, esperado %.6f (+-%g)\n", __FILE__, __LINE__, #a, _a, _b, (double)(tol)); test_failures++; } \
+} while (0)
+
+#define TEST_END() (test_failures ? (fprintf(stderr, "%d falha(s)\n", test_failures), 1) : 0)
+
+// Fonte de bytes lendo um arquivo gravado (a mesma interface da UART)
+static inline int test_file_read(void *ctx, uint8_t *buf, size_t len) {
+    FILE *f = (FILE *)ctx;
+    size_t n = fread(buf, 1, len, f);
+    return (n == 0 && ferror(f)) ? -1 : (int)n;
+}
+
+static inline FILE *test_fixture(const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", FIXTURES, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) { fprintf(stderr, "sem fixture: %s\n", path); exit(2); }
+    return f;
+}
+
+#endif